@@ -27,6 +27,13 @@
 #ifndef CMSPAR
 #define CMSPAR 010000000000
 #endif
+#ifndef TIOCGRS485
+#define TIOCGRS485 0x542E
+#endif
+#ifndef TIOCSRS485
+#define TIOCSRS485 0x542F
+#endif
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <sys/ioctl.h>
@@ -36,323 +43,2432 @@
 #include <cerrno>
 #include <unistd.h>
 #include <termios.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <sys/inotify.h>
+#include <climits>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <sys/time.h>
+#include <time.h>
 #include "../j_extensions_comm_SerialComm.h"
+#include "SerialPort.h"
 
-JNIEXPORT jobjectArray JNICALL Java_j_extensions_comm_SerialComm_getCommPorts(JNIEnv *env, jclass serialCommClass)
+#define REALTIME_STACK_PREFAULT		(64 * 1024)
+#define GNSS_RECORD_HEADER_SIZE		16
+#define TRANSFER_TIMEOUT			-1
+#define TRANSFER_PORT_ERROR			-2
+#define TRANSFER_FILE_ERROR			-3
+#define TRANSFER_ABORTED			-4
+#define XMODEM_SOH					0x01
+#define XMODEM_STX					0x02
+#define XMODEM_EOT					0x04
+#define XMODEM_ACK					0x06
+#define XMODEM_NAK					0x15
+#define XMODEM_CAN					0x18
+#define XMODEM_MAX_RETRIES			10
+#define BROKER_MAGIC				0x53434252u
+#define BROKER_HEADER_SIZE			4096
+#define BROKER_MAX_READ_CHUNK		4096
+#define TRACE_RING_SIZE				4096
+#define TRACE_FILE_VERSION			1
+// Closes the port and marks the Java object as closed, unless it has already been reopened with a different handle
+static void closeJavaPort(JNIEnv *env, jobject obj, jlong handle)
 {
-	DIR *serialPortIterator;
-	struct dirent *serialPortEntry;
-	int serialPort;
-	int numValues = -2, numChars, index = 0;
-	char portString[1024], comPort[1024], pathBase[21] = {"/dev/serial/by-path/"};
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jfieldID portHandleID = env->GetFieldID(serialCommClass, "portHandle", "J");
+	closePortHandle(handle);
+	if (env->GetLongField(obj, portHandleID) == handle)
+	{
+		// A port that failed rather than being closed by the user is reopened automatically if requested
+		env->SetLongField(obj, portHandleID, -1l);
+		env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "reconnecting", "Z"),
+				env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "autoReconnect", "Z")));
+		env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "isOpened", "Z"), JNI_FALSE);
+	}
+}
 
-	// Get relevant SerialComm methods and IDs
-	jmethodID serialCommConstructor = env->GetMethodID(serialCommClass, "<init>", "()V");
-	jfieldID portStringID = env->GetFieldID(serialCommClass, "portString", "Ljava/lang/String;");
-	jfieldID comPortID = env->GetFieldID(serialCommClass, "comPort", "Ljava/lang/String;");
+// Returns whether a region lies entirely within a Java byte array, so that it can be safely copied through a raw array pointer
+static bool isArrayRegionValid(JNIEnv *env, jbyteArray array, jlong offset, jlong length)
+{
+	return (offset >= 0) && (length >= 0) && (length <= (env->GetArrayLength(array) - offset));
+}
 
-	// Enumerate serial ports on machine
-	if ((serialPortIterator = opendir(pathBase)) == NULL)
-		return NULL;
-	while (readdir(serialPortIterator) != NULL) ++numValues;
-	rewinddir(serialPortIterator);
-	jobjectArray arrayObject = env->NewObjectArray(numValues, serialCommClass, 0);
-	while ((serialPortEntry = readdir(serialPortIterator)) != NULL)
-	{
-		// Get serial COM value
-		strcpy(portString, pathBase);
-		strcpy(portString+20, serialPortEntry->d_name);
-		if ((numChars = readlink(portString, comPort, sizeof(comPort))) == -1)
-			continue;
-		comPort[numChars] = '\0';
+// Native functions recorded by the call trace (the order must match TRACE_FUNCTION_NAMES in SerialComm.java), with the functions
+// that return booleans listed first so that TRACE_LAST_BOOLEAN_FUNCTION in SerialComm.java can tell their results apart
+enum TracedFunctions { TRACE_OPEN_PORT = 1, TRACE_CLOSE_PORT, TRACE_CONFIG_PORT, TRACE_CONFIG_FLOW_CONTROL, TRACE_CONFIG_TIMEOUTS,
+	TRACE_CONFIG_RS485, TRACE_BYTES_AVAILABLE, TRACE_READ_BYTES, TRACE_READ_AVAILABLE_BYTES, TRACE_WRITE_BYTES, TRACE_TRANSMIT_FILE,
+	TRACE_READ_UNTIL_MATCH, TRACE_READ_INTO_POOLED_BUFFER, TRACE_LAST_BOOLEAN_FUNCTION = TRACE_CONFIG_RS485 };
 
-		// Get port name
-		strcpy(portString, strrchr(comPort, '/') + 1);
-		strcpy(comPort, "/dev/");
-		strcpy(comPort+5, portString);
+// A single traced call, written to the trace file exactly as laid out here (little-endian, 40 bytes)
+typedef struct TraceEvent
+{
+	jlong startTime, argument, result;
+	unsigned int duration;
+	int portSlot;
+	unsigned short function, errorCode;
+	unsigned int sequence;
+} TraceEvent;
 
-		// Create new SerialComm object containing the enumerated values
-		jobject serialCommObject = env->NewObject(serialCommClass, serialCommConstructor);
-		env->SetObjectField(serialCommObject, portStringID, env->NewStringUTF(portString));
-		env->SetObjectField(serialCommObject, comPortID, env->NewStringUTF(comPort));
+// Each thread records into its own ring without any locking; rings are linked into a global list that only ever grows,
+// and the ring of a thread that has exited is handed to the next thread that needs one
+typedef struct TraceRing
+{
+	struct TraceRing *next;
+	int threadId, inUse;
+	unsigned long long head;
+	TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+static TraceRing *traceRings = NULL;
+static __thread TraceRing *threadTraceRing = NULL;
+static pthread_key_t traceRingKey;
+static pthread_once_t traceRingKeyOnce = PTHREAD_ONCE_INIT;
+static int traceEnabled = 0;
 
-		// Add new SerialComm object to array
-		env->SetObjectArrayElement(arrayObject, index++, serialCommObject);
-	}
-	closedir(serialPortIterator);
+// Returns a ring to the global list when its thread exits
+static void releaseTraceRing(void *ring)
+{
+	__atomic_store_n(&((TraceRing*)ring)->inUse, 0, __ATOMIC_RELEASE);
+}
 
-	return arrayObject;
+static void createTraceRingKey(void)
+{
+	pthread_key_create(&traceRingKey, releaseTraceRing);
 }
 
-JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_openPort(JNIEnv *env, jobject obj)
+// Returns the calling thread's trace ring, reusing or allocating one the first time the thread records an event
+static TraceRing* getTraceRing(void)
 {
-	int fdSerial;
-	jstring portNameJString = (jstring)env->GetObjectField(obj, env->GetFieldID(env->GetObjectClass(obj), "comPort", "Ljava/lang/String;"));
-	const char *portName = env->GetStringUTFChars(portNameJString, NULL);
+	if (threadTraceRing != NULL)
+		return threadTraceRing;
+	pthread_once(&traceRingKeyOnce, createTraceRingKey);
 
-	// Try to open existing serial port with read/write access
-	if ((fdSerial = open(portName, O_RDWR | O_NOCTTY | O_NDELAY)) > 0)
+	TraceRing *ring = __atomic_load_n(&traceRings, __ATOMIC_ACQUIRE);
+	int notInUse = 0;
+	while ((ring != NULL) && !__atomic_compare_exchange_n(&ring->inUse, &notInUse, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
 	{
-		// Set port handle in Java structure
-		env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), fdSerial);
+		ring = ring->next;
+		notInUse = 0;
+	}
+	if (ring == NULL)
+	{
+		if ((ring = (TraceRing*)calloc(1, sizeof(TraceRing))) == NULL)
+			return NULL;
+		ring->inUse = 1;
+		ring->next = __atomic_load_n(&traceRings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&traceRings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+	else
+		__atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+	ring->threadId = (int)syscall(SYS_gettid);
+	pthread_setspecific(traceRingKey, ring);
+	return (threadTraceRing = ring);
+}
 
-		// Configure the port parameters and timeouts
-		if (Java_j_extensions_comm_SerialComm_configPort(env, obj) && Java_j_extensions_comm_SerialComm_configFlowControl(env, obj) &&
-				Java_j_extensions_comm_SerialComm_configTimeouts(env, obj))
-			env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_TRUE);
-		else
+// Returns the start time of a traced call, or 0 if tracing is disabled
+static inline jlong traceBegin(void)
+{
+	if (!__atomic_load_n(&traceEnabled, __ATOMIC_RELAXED))
+		return 0;
+	errno = 0;
+	return getMonotonicTime();
+}
+
+// Records a traced call in the calling thread's ring and passes its result through unchanged
+static jlong traceCall(int function, jlong portHandle, jlong argument, jlong result, jlong startTime)
+{
+	int errorCode = errno;
+	TraceRing *ring;
+	if ((startTime == 0) || ((ring = getTraceRing()) == NULL))
+		return result;
+
+	// Invalidate the slot while it is being overwritten, so a concurrent dump can detect a torn event
+	jlong duration = getMonotonicTime() - startTime;
+	TraceEvent *event = &ring->events[ring->head & (TRACE_RING_SIZE - 1)];
+	__atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	event->startTime = startTime;
+	event->argument = argument;
+	event->result = result;
+	event->duration = (duration > 0xFFFFFFFFll) ? 0xFFFFFFFFu : (unsigned int)duration;
+	event->portSlot = (portHandle == -1l) ? -1 : (int)(portHandle & 0xFFFFFFFFll);
+	event->function = (unsigned short)function;
+	event->errorCode = (unsigned short)errorCode;
+	__atomic_store_n(&event->sequence, (unsigned int)(ring->head + 1), __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+	errno = errorCode;
+	return result;
+}
+
+// Copies the port settings from the Java object into a native port configuration
+static void getPortConfig(JNIEnv *env, jobject obj, SerialPortConfig *config)
+{
+	jclass serialCommClass = env->GetObjectClass(obj);
+	config->baudRate = env->GetIntField(obj, env->GetFieldID(serialCommClass, "baudRate", "I"));
+	config->dataBits = env->GetIntField(obj, env->GetFieldID(serialCommClass, "dataBits", "I"));
+	config->stopBits = env->GetIntField(obj, env->GetFieldID(serialCommClass, "stopBits", "I"));
+	config->parity = env->GetIntField(obj, env->GetFieldID(serialCommClass, "parity", "I"));
+	config->flowControl = env->GetIntField(obj, env->GetFieldID(serialCommClass, "flowControl", "I"));
+	config->timeoutMode = env->GetIntField(obj, env->GetFieldID(serialCommClass, "timeoutMode", "I"));
+	config->readTimeout = env->GetIntField(obj, env->GetFieldID(serialCommClass, "readTimeout", "I"));
+	config->writeTimeout = env->GetIntField(obj, env->GetFieldID(serialCommClass, "writeTimeout", "I"));
+	config->rs485Mode = env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485Mode", "Z"));
+	config->rs485RtsActiveHigh = env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485RtsActiveHigh", "Z"));
+	config->rs485RxDuringTx = env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485RxDuringTx", "Z"));
+	config->rs485Emulated = env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485Emulated", "Z"));
+	config->rs485DelayBefore = env->GetIntField(obj, env->GetFieldID(serialCommClass, "rs485DelayBefore", "I"));
+	config->rs485DelayAfter = env->GetIntField(obj, env->GetFieldID(serialCommClass, "rs485DelayAfter", "I"));
+	config->pacingInterByteGap = env->GetDoubleField(obj, env->GetFieldID(serialCommClass, "pacingInterByteGap", "D"));
+	config->pacingInterFrameGap = env->GetDoubleField(obj, env->GetFieldID(serialCommClass, "pacingInterFrameGap", "D"));
+	config->pacingUnits = env->GetIntField(obj, env->GetFieldID(serialCommClass, "pacingUnits", "I"));
+}
+
+// Adds the gaps measured during one paced write to the port's statistics, holding the same lock as the Java accessors
+static void mergePacingStatistics(JNIEnv *env, jobject obj, const jlong *measured)
+{
+	jlongArray statisticsArray = (jlongArray)env->GetObjectField(obj, env->GetFieldID(env->GetObjectClass(obj), "pacingStatistics", "[J"));
+	jlong statistics[PACING_NUM_STATISTICS];
+	env->MonitorEnter(statisticsArray);
+	env->GetLongArrayRegion(statisticsArray, 0, PACING_NUM_STATISTICS, statistics);
+	for (int baseIndex = PACING_BYTE_GAP_COUNT; baseIndex <= PACING_FRAME_GAP_COUNT; baseIndex += (PACING_FRAME_GAP_COUNT - PACING_BYTE_GAP_COUNT))
+		if (measured[baseIndex])
 		{
-			// Close the port if there was a problem setting the parameters
-			close(fdSerial);
-			fdSerial = -1;
-			env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-			env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
+			if ((statistics[baseIndex] == 0) || (measured[baseIndex + 2] < statistics[baseIndex + 2]))
+				statistics[baseIndex + 2] = measured[baseIndex + 2];
+			if ((statistics[baseIndex] == 0) || (measured[baseIndex + 3] > statistics[baseIndex + 3]))
+				statistics[baseIndex + 3] = measured[baseIndex + 3];
+			statistics[baseIndex + 1] += measured[baseIndex + 1];
+			statistics[baseIndex] += measured[baseIndex];
 		}
-	}
+	statistics[PACING_BYTE_GAP_REQUESTED] = measured[PACING_BYTE_GAP_REQUESTED];
+	statistics[PACING_FRAME_GAP_REQUESTED] = measured[PACING_FRAME_GAP_REQUESTED];
+	env->SetLongArrayRegion(statisticsArray, 0, PACING_NUM_STATISTICS, statistics);
+	env->MonitorExit(statisticsArray);
+}
 
-	env->ReleaseStringUTFChars(portNameJString, portName);
-	return (fdSerial == -1) ? JNI_FALSE : JNI_TRUE;
+// Writes all data to the port using the Java object's current settings, recording the achieved gaps of a paced write
+static int writeToJavaPort(JNIEnv *env, jobject obj, SerialPortHandle *port, const void *buffer, int bytesToWrite)
+{
+	SerialPortConfig config;
+	jlong statistics[PACING_NUM_STATISTICS] = { 0 }, interByteGap, interFrameGap;
+	getPortConfig(env, obj, &config);
+	int numBytesWritten = writeToPort(port, &config, buffer, bytesToWrite, statistics);
+	if ((numBytesWritten != -1) && getPacingGaps(&config, &interByteGap, &interFrameGap))
+		mergePacingStatistics(env, obj, statistics);
+	return numBytesWritten;
 }
 
-JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configPort(JNIEnv *env, jobject obj)
+// Touches and locks a region of the calling thread's stack so that later native calls never take page faults on it
+static __attribute__((noinline)) bool prefaultStack(void)
 {
-	struct termios options;
-	struct serial_struct serialInfo;
-	jclass serialCommClass = env->GetObjectClass(obj);
-	int portFD = (int)env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	volatile unsigned char stackBuffer[REALTIME_STACK_PREFAULT];
+	memset((void*)stackBuffer, 0, sizeof(stackBuffer));
+	return (mlock((const void*)stackBuffer, sizeof(stackBuffer)) == 0);
+}
 
-	// Set raw-mode to allow the use of tcsetattr() and ioctl()
-	fcntl(portFD, F_SETFL, 0);
-	cfmakeraw(&options);
+// Native buffers allocated by the library for brokers, receive pools, and GNSS parsers, all of which are locked into RAM
+// (including any allocated later) once a thread has applied real-time settings with memory locking enabled
+typedef struct NativeBuffer
+{
+	struct NativeBuffer *next;
+	void *address;
+	size_t length;
+} NativeBuffer;
+static NativeBuffer *nativeBuffers = NULL;
+static pthread_mutex_t nativeBuffersMutex = PTHREAD_MUTEX_INITIALIZER;
+static bool nativeBuffersLocked = false;
 
-	// Get port parameters from Java class
-	int baudRate = env->GetIntField(obj, env->GetFieldID(serialCommClass, "baudRate", "I"));
-	int byteSizeInt = env->GetIntField(obj, env->GetFieldID(serialCommClass, "dataBits", "I"));
-	int stopBitsInt = env->GetIntField(obj, env->GetFieldID(serialCommClass, "stopBits", "I"));
-	int parityInt = env->GetIntField(obj, env->GetFieldID(serialCommClass, "parity", "I"));
-	tcflag_t byteSize = (byteSizeInt == 5) ? CS5 : (byteSizeInt == 6) ? CS6 : (byteSizeInt == 7) ? CS7 : CS8;
-	tcflag_t stopBits = ((stopBitsInt == j_extensions_comm_SerialComm_ONE_STOP_BIT) || (stopBitsInt == j_extensions_comm_SerialComm_ONE_POINT_FIVE_STOP_BITS)) ? 0 : CSTOPB;
-	tcflag_t parity = (parityInt == j_extensions_comm_SerialComm_NO_PARITY) ? 0 : (parityInt == j_extensions_comm_SerialComm_ODD_PARITY) ? (PARENB | PARODD) : (parityInt == j_extensions_comm_SerialComm_EVEN_PARITY) ? PARENB : (parityInt == j_extensions_comm_SerialComm_MARK_PARITY) ? (PARENB | CMSPAR | PARODD) : (PARENB | CMSPAR);
-	int flowControl = env->GetIntField(obj, env->GetFieldID(serialCommClass, "flowControl", "I"));
-	tcflag_t XonXoffInEnabled = ((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_XONXOFF_IN_ENABLED) > 0) ? IXOFF : 0;
-	tcflag_t XonXoffOutEnabled = ((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_XONXOFF_OUT_ENABLED) > 0) ? IXON : 0;
-
-	// Retrieve existing port configuration
-	tcgetattr(portFD, &options);
-
-	// Set updated port parameters
-	options.c_cflag = (B38400 | byteSize | stopBits | parity | CLOCAL | CREAD);
-	if (parityInt == j_extensions_comm_SerialComm_SPACE_PARITY)
-		options.c_cflag &= ~PARODD;
-	options.c_iflag = ((parityInt > 0) ? (INPCK | ISTRIP) : IGNPAR);
-	options.c_oflag = 0;
-	options.c_lflag = 0;
-
-	// Apply changes
-	tcsetattr(portFD, TCSAFLUSH, &options);
-	ioctl(portFD, TIOCEXCL);				// Block non-root users from using this port
-
-	// Allow custom baud rate (only for true serial ports)
-	ioctl(portFD, TIOCGSERIAL, &serialInfo);
-	serialInfo.flags = ASYNC_SPD_CUST | ASYNC_LOW_LATENCY;
-	serialInfo.custom_divisor = serialInfo.baud_base / baudRate;
-	ioctl(portFD, TIOCSSERIAL, &serialInfo);
-	return JNI_TRUE;
+// Records a newly allocated native buffer, locking it right away if memory locking has already been requested
+static void registerNativeBuffer(void *address, size_t length)
+{
+	NativeBuffer *buffer = (NativeBuffer*)malloc(sizeof(NativeBuffer));
+	if (buffer == NULL)
+		return;
+	buffer->address = address;
+	buffer->length = length;
+	pthread_mutex_lock(&nativeBuffersMutex);
+	buffer->next = nativeBuffers;
+	nativeBuffers = buffer;
+	if (nativeBuffersLocked)
+		mlock(address, length);
+	pthread_mutex_unlock(&nativeBuffersMutex);
 }
 
-JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configFlowControl(JNIEnv *env, jobject obj)
+// Forgets a native buffer that is about to be freed; unmapping a buffer unlocks it, and freed heap pages simply stay locked
+static void unregisterNativeBuffer(void *address)
+{
+	NativeBuffer **link, *buffer = NULL;
+	pthread_mutex_lock(&nativeBuffersMutex);
+	for (link = &nativeBuffers; *link != NULL; link = &(*link)->next)
+		if ((*link)->address == address)
+		{
+			buffer = *link;
+			*link = buffer->next;
+			break;
+		}
+	pthread_mutex_unlock(&nativeBuffersMutex);
+	free(buffer);
+}
+
+// Locks every native buffer into RAM, along with every buffer allocated from now on
+static bool lockNativeBuffers(void)
+{
+	bool success = true;
+	pthread_mutex_lock(&nativeBuffersMutex);
+	nativeBuffersLocked = true;
+	for (NativeBuffer *buffer = nativeBuffers; buffer != NULL; buffer = buffer->next)
+		success = (mlock(buffer->address, buffer->length) == 0) && success;
+	pthread_mutex_unlock(&nativeBuffersMutex);
+	return success;
+}
+
+// Applies the port's CPU affinity, scheduling policy, and memory locking settings to the calling thread
+static bool applyRealtimeSettings(JNIEnv *env, jobject obj)
 {
-	struct termios options;
+	// Get real-time settings from Java class
 	jclass serialCommClass = env->GetObjectClass(obj);
-	int portFD = (int)env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	jlong cpuMask = env->GetLongField(obj, env->GetFieldID(serialCommClass, "realtimeCpuMask", "J"));
+	int policy = env->GetIntField(obj, env->GetFieldID(serialCommClass, "realtimePolicy", "I"));
+	int priority = env->GetIntField(obj, env->GetFieldID(serialCommClass, "realtimePriority", "I"));
+	bool lockMemory = env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "realtimeLockMemory", "Z"));
+	bool success = true;
 
-	// Get port parameters from Java class
-	int flowControl = env->GetIntField(obj, env->GetFieldID(serialCommClass, "flowControl", "I"));
-	tcflag_t CTSRTSEnabled = (((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_CTS_ENABLED) > 0) ||
-			((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_RTS_ENABLED) > 0)) ? CRTSCTS : 0;
-	tcflag_t XonXoffInEnabled = ((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_XONXOFF_IN_ENABLED) > 0) ? IXOFF : 0;
-	tcflag_t XonXoffOutEnabled = ((flowControl & j_extensions_comm_SerialComm_FLOW_CONTROL_XONXOFF_OUT_ENABLED) > 0) ? IXON : 0;
+	// Pin the thread to the requested CPUs, leaving the affinity inherited from the process alone if none were specified
+	if (cpuMask != 0)
+	{
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		for (int i = 0; (i < CPU_SETSIZE) && (i < 64); ++i)
+			if (cpuMask & (1ll << i))
+				CPU_SET(i, &cpuSet);
+		success = (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0) && success;
+	}
 
-	// Retrieve existing port configuration
-	tcgetattr(portFD, &options);
+	// Switch to a real-time scheduling policy if one was requested, clamping the priority to the range allowed by the policy, and
+	// otherwise leave the thread's existing policy (such as SCHED_BATCH or SCHED_IDLE) alone
+	if ((policy == j_extensions_comm_SerialComm_SCHEDULING_FIFO) || (policy == j_extensions_comm_SerialComm_SCHEDULING_ROUND_ROBIN))
+	{
+		struct sched_param schedulingParams;
+		policy = (policy == j_extensions_comm_SerialComm_SCHEDULING_FIFO) ? SCHED_FIFO : SCHED_RR;
+		if (priority < sched_get_priority_min(policy))
+			priority = sched_get_priority_min(policy);
+		else if (priority > sched_get_priority_max(policy))
+			priority = sched_get_priority_max(policy);
+		schedulingParams.sched_priority = priority;
+		success = (sched_setscheduler(0, policy, &schedulingParams) == 0) && success;
+	}
 
-	// Set updated port parameters
-	options.c_cflag |= CTSRTSEnabled;
-	options.c_iflag |= XonXoffInEnabled | XonXoffOutEnabled;
-	options.c_oflag = 0;
-	options.c_lflag = 0;
+	// Pre-fault and lock the thread's stack, which holds the temporary I/O buffers, along with the shared port table and the
+	// native buffers of every broker, receive pool, and GNSS parser
+	if (lockMemory)
+		success = prefaultStack() && lockPortHandles() && lockNativeBuffers() && success;
+	return success;
+}
 
-	// Apply changes
-	tcsetattr(portFD, TCSAFLUSH, &options);
-	return JNI_TRUE;
+// Applies the port's real-time settings, if any were specified, to a thread that the library started to service the port
+static void prepareServiceThread(JNIEnv *env, jobject obj)
+{
+	if (env->GetIntField(obj, env->GetFieldID(env->GetObjectClass(obj), "realtimeVersion", "I")) != 0)
+		applyRealtimeSettings(env, obj);
 }
 
-JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configTimeouts(JNIEnv *env, jobject obj)
+// Scheduling settings of a thread, saved so that they can be restored after temporarily applying a port's real-time settings
+typedef struct ThreadSchedulingState
 {
-	// Get port timeouts from Java class
-	jclass serialCommClass = env->GetObjectClass(obj);
-	int serialFD = (int)env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
-	int timeoutMode = env->GetIntField(obj, env->GetFieldID(serialCommClass, "timeoutMode", "I"));
-	int readTimeout = env->GetIntField(obj, env->GetFieldID(serialCommClass, "readTimeout", "I"));
+	cpu_set_t cpuSet;
+	struct sched_param schedulingParams;
+	int policy;
+	bool affinityValid;
+} ThreadSchedulingState;
+
+// Saves the CPU affinity and scheduling policy of the calling thread
+static void saveThreadScheduling(ThreadSchedulingState *state)
+{
+	state->affinityValid = (sched_getaffinity(0, sizeof(state->cpuSet), &state->cpuSet) == 0);
+	state->policy = sched_getscheduler(0);
+	sched_getparam(0, &state->schedulingParams);
+}
 
-	// Retrieve existing port configuration
-	struct termios options;
-	tcgetattr(serialFD, &options);
+// Restores the CPU affinity and scheduling policy of the calling thread
+static void restoreThreadScheduling(const ThreadSchedulingState *state)
+{
+	if (state->policy != -1)
+		sched_setscheduler(0, state->policy, &state->schedulingParams);
+	if (state->affinityValid)
+		sched_setaffinity(0, sizeof(state->cpuSet), &state->cpuSet);
+}
+
+// Native state of a GNSS message parser, followed in memory by storage for the message currently being assembled
+enum GnssParserStates { GNSS_IDLE, GNSS_UBX_SYNC, GNSS_UBX_HEADER, GNSS_UBX_PAYLOAD, GNSS_UBX_CHECKSUM_A, GNSS_UBX_CHECKSUM_B,
+	GNSS_NMEA_BODY, GNSS_NMEA_CHECKSUM_HIGH, GNSS_NMEA_CHECKSUM_LOW };
+typedef struct GnssParserState
+{
+	int state, maxMessageLength, messageLength, payloadLength, pendingMessageType, inputStart, inputEnd;
+	unsigned char checksumA, checksumB, receivedChecksum;
+	jlong numUbxMessages, numNmeaMessages, numChecksumErrors, numDiscardedBytes;
+	void *messageBuffer;
+	unsigned char inputBuffer[4096];
+	unsigned char message[1];
+} GnssParserState;
 
-	// Set updated port timeouts
-	switch (timeoutMode)
+// Returns the value of a hexadecimal digit, or -1 if the character is not one
+static int hexDigitValue(unsigned char digit)
+{
+	if ((digit >= '0') && (digit <= '9'))
+		return digit - '0';
+	else if ((digit >= 'A') && (digit <= 'F'))
+		return digit - 'A' + 10;
+	else if ((digit >= 'a') && (digit <= 'f'))
+		return digit - 'a' + 10;
+	return -1;
+}
+
+// Advances the parser state machine by one byte, returning the type of message completed by this byte, or 0 if none
+static int feedGnssByte(GnssParserState *parser, unsigned char byte)
+{
+	int digitValue;
+	switch (parser->state)
 	{
-		case j_extensions_comm_SerialComm_TIMEOUT_READ_SEMI_BLOCKING:	// Read Semi-blocking
-			options.c_cc[VMIN] = 0;
-			options.c_cc[VTIME] = readTimeout / 100;
+		case GNSS_IDLE:				// Hunt for the start of a UBX frame or NMEA sentence, ignoring line endings between sentences
+			if (byte == 0xB5)
+				parser->state = GNSS_UBX_SYNC;
+			else if (byte == '$')
+			{
+				parser->state = GNSS_NMEA_BODY;
+				parser->messageLength = 0;
+				parser->checksumA = 0;
+			}
+			else if ((byte != '\r') && (byte != '\n'))
+				++parser->numDiscardedBytes;
+			break;
+		case GNSS_UBX_SYNC:
+			if (byte == 0x62)
+			{
+				parser->state = GNSS_UBX_HEADER;
+				parser->messageLength = 0;
+				parser->checksumA = parser->checksumB = 0;
+			}
+			else
+			{
+				// Not a UBX frame after all, so re-examine this byte as a potential start of message
+				++parser->numDiscardedBytes;
+				parser->state = GNSS_IDLE;
+				return feedGnssByte(parser, byte);
+			}
+			break;
+		case GNSS_UBX_HEADER:		// Class, ID, and little-endian payload length
+		case GNSS_UBX_PAYLOAD:
+			parser->message[parser->messageLength++] = byte;
+			parser->checksumA += byte;
+			parser->checksumB += parser->checksumA;
+			if ((parser->state == GNSS_UBX_HEADER) && (parser->messageLength == 4))
+			{
+				parser->payloadLength = parser->message[2] | (parser->message[3] << 8);
+				if ((parser->payloadLength + 4) > parser->maxMessageLength)
+				{
+					// Impossible length, most likely a false sync, so resume hunting right after the header
+					parser->numDiscardedBytes += 6;
+					parser->state = GNSS_IDLE;
+				}
+				else
+					parser->state = (parser->payloadLength == 0) ? GNSS_UBX_CHECKSUM_A : GNSS_UBX_PAYLOAD;
+			}
+			else if ((parser->state == GNSS_UBX_PAYLOAD) && (parser->messageLength == (parser->payloadLength + 4)))
+				parser->state = GNSS_UBX_CHECKSUM_A;
+			break;
+		case GNSS_UBX_CHECKSUM_A:
+			parser->receivedChecksum = byte;
+			parser->state = GNSS_UBX_CHECKSUM_B;
+			break;
+		case GNSS_UBX_CHECKSUM_B:	// Validate the 8-bit Fletcher checksum over the class, ID, length, and payload
+			parser->state = GNSS_IDLE;
+			if ((parser->receivedChecksum == parser->checksumA) && (byte == parser->checksumB))
+				return j_extensions_comm_SerialComm_GNSS_MESSAGE_UBX;
+			++parser->numChecksumErrors;
+			parser->numDiscardedBytes += parser->messageLength + 4;
 			break;
-		case j_extensions_comm_SerialComm_TIMEOUT_READ_BLOCKING:		// Read Blocking
-			options.c_cc[VMIN] = 0;
-			options.c_cc[VTIME] = 1;
+		case GNSS_NMEA_BODY:
+			if (byte == '*')
+				parser->state = GNSS_NMEA_CHECKSUM_HIGH;
+			else if ((byte < 0x20) || (byte > 0x7E) || (byte == '$') || (parser->messageLength == parser->maxMessageLength))
+			{
+				// Truncated or corrupt sentence, so re-examine this byte as a potential start of message
+				parser->numDiscardedBytes += parser->messageLength + 1;
+				parser->state = GNSS_IDLE;
+				return feedGnssByte(parser, byte);
+			}
+			else
+			{
+				parser->message[parser->messageLength++] = byte;
+				parser->checksumA ^= byte;
+			}
 			break;
-		case j_extensions_comm_SerialComm_TIMEOUT_NONBLOCKING:			// Non-blocking
-		default:
-			options.c_cc[VMIN] = 0;
-			options.c_cc[VTIME] = 0;
+		case GNSS_NMEA_CHECKSUM_HIGH:
+		case GNSS_NMEA_CHECKSUM_LOW:	// Validate the XOR checksum over all characters between '$' and '*'
+			if ((digitValue = hexDigitValue(byte)) < 0)
+			{
+				parser->numDiscardedBytes += parser->messageLength + ((parser->state == GNSS_NMEA_CHECKSUM_HIGH) ? 2 : 3);
+				parser->state = GNSS_IDLE;
+				return feedGnssByte(parser, byte);
+			}
+			else if (parser->state == GNSS_NMEA_CHECKSUM_HIGH)
+			{
+				parser->receivedChecksum = (unsigned char)(digitValue << 4);
+				parser->state = GNSS_NMEA_CHECKSUM_LOW;
+			}
+			else
+			{
+				parser->state = GNSS_IDLE;
+				if ((parser->receivedChecksum | digitValue) == parser->checksumA)
+				{
+					parser->payloadLength = parser->messageLength;
+					return j_extensions_comm_SerialComm_GNSS_MESSAGE_NMEA;
+				}
+				++parser->numChecksumErrors;
+				parser->numDiscardedBytes += parser->messageLength + 4;
+			}
 			break;
 	}
+	return 0;
+}
+
+// Appends the most recently completed message to the output buffer as a little-endian record, returning false if it does not fit
+static bool emitGnssMessage(GnssParserState *parser, int messageType, unsigned char *output, int outputCapacity, int *outputLength, jlong timestamp)
+{
+	unsigned char *record = output + *outputLength;
+	if ((*outputLength + GNSS_RECORD_HEADER_SIZE + parser->payloadLength) > outputCapacity)
+		return false;
 
-	// Apply changes
-	return (tcsetattr(serialFD, TCSAFLUSH, &options) == 0) ? JNI_TRUE : JNI_FALSE;
+	// Record header: type, UBX class, UBX ID, reserved, payload length, and monotonic receive time
+	bool isUbx = (messageType == j_extensions_comm_SerialComm_GNSS_MESSAGE_UBX);
+	record[0] = (unsigned char)messageType;
+	record[1] = isUbx ? parser->message[0] : 0;
+	record[2] = isUbx ? parser->message[1] : 0;
+	record[3] = 0;
+	for (int i = 0; i < 4; ++i)
+		record[4 + i] = (unsigned char)(parser->payloadLength >> (8 * i));
+	for (int i = 0; i < 8; ++i)
+		record[8 + i] = (unsigned char)(timestamp >> (8 * i));
+	memcpy(record + GNSS_RECORD_HEADER_SIZE, parser->message + (isUbx ? 4 : 0), parser->payloadLength);
+	*outputLength += GNSS_RECORD_HEADER_SIZE + parser->payloadLength;
+	if (messageType == j_extensions_comm_SerialComm_GNSS_MESSAGE_UBX)
+		++parser->numUbxMessages;
+	else
+		++parser->numNmeaMessages;
+	return true;
 }
 
-JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_closePort(JNIEnv *env, jobject obj)
+// Parses raw receiver data into the output buffer, returning the number of input bytes consumed before the output filled up
+static int parseGnssBytes(GnssParserState *parser, const unsigned char *data, int length, unsigned char *output, int outputCapacity, int *outputLength, int *numMessages, jlong timestamp)
 {
-	// Close port
-	int portFD = (int)env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
-	close(portFD);
-	env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-	env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
+	int messageType;
+
+	// Deliver a message left over from a previous call whose output buffer was full
+	if (parser->pendingMessageType != 0)
+	{
+		if (!emitGnssMessage(parser, parser->pendingMessageType, output, outputCapacity, outputLength, timestamp))
+			return 0;
+		parser->pendingMessageType = 0;
+		++*numMessages;
+	}
 
-	return JNI_TRUE;
+	for (int i = 0; i < length; ++i)
+		if ((messageType = feedGnssByte(parser, data[i])) != 0)
+		{
+			if (!emitGnssMessage(parser, messageType, output, outputCapacity, outputLength, timestamp))
+			{
+				parser->pendingMessageType = messageType;
+				return i + 1;
+			}
+			++*numMessages;
+		}
+	return length;
 }
 
-JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_bytesAvailable(JNIEnv *env, jobject obj)
+// Copies the parser statistics and output state into its Java object
+static void updateGnssParser(JNIEnv *env, jobject parserObj, GnssParserState *parser, int outputLength, int numMessages)
 {
-	int serialPortFD = (int)env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
-	int numBytesAvailable;
+	jclass parserClass = env->GetObjectClass(parserObj);
+	env->SetIntField(parserObj, env->GetFieldID(parserClass, "outputLength", "I"), outputLength);
+	env->SetIntField(parserObj, env->GetFieldID(parserClass, "numMessages", "I"), numMessages);
+	env->SetIntField(parserObj, env->GetFieldID(parserClass, "nextPosition", "I"), 0);
+	env->SetLongField(parserObj, env->GetFieldID(parserClass, "numUbxMessages", "J"), parser->numUbxMessages);
+	env->SetLongField(parserObj, env->GetFieldID(parserClass, "numNmeaMessages", "J"), parser->numNmeaMessages);
+	env->SetLongField(parserObj, env->GetFieldID(parserClass, "numChecksumErrors", "J"), parser->numChecksumErrors);
+	env->SetLongField(parserObj, env->GetFieldID(parserClass, "numDiscardedBytes", "J"), parser->numDiscardedBytes);
+}
 
-    ioctl(serialPortFD, FIONREAD, &numBytesAvailable);
-	
-	return numBytesAvailable;
+// Updates the Java file transfer progress, counting only bytes that have actually left the kernel output queue
+static void updateTransferProgress(JNIEnv *env, jobject obj, int portFD, jlong bytesQueued)
+{
+	int bytesWaiting = 0;
+	if ((portFD >= 0) && (ioctl(portFD, TIOCOUTQ, &bytesWaiting) == 0) && (bytesWaiting <= bytesQueued))
+		bytesQueued -= bytesWaiting;
+	env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "fileBytesSent", "J"), bytesQueued);
 }
 
-JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jlong bytesToRead)
+// Streams a file region to the port, letting the kernel copy it directly from the page cache whenever the tty supports it
+static jlong streamFileToPort(JNIEnv *env, jobject obj, SerialPortHandle *port, int fileFD, const unsigned char *fileData, jlong offset, jlong length)
 {
-	// Get port handle and read timeout from Java class
-	jbyte *readBuffer = env->GetByteArrayElements(buffer, 0);
-	jclass serialCommClass = env->GetObjectClass(obj);
-	int timeoutMode = env->GetIntField(obj, env->GetFieldID(serialCommClass, "timeoutMode", "I"));
-	int readTimeout = env->GetIntField(obj, env->GetFieldID(serialCommClass, "readTimeout", "I"));
-	int serialPortFD = (int)env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
-	int numBytesRead, bytesRemaining = bytesToRead, index = 0;
+	SerialPortConfig config;
+	jlong interByteGap, interFrameGap;
+	getPortConfig(env, obj, &config);
+	bool useSendfile = !config.rs485Emulated && !getPacingGaps(&config, &interByteGap, &interFrameGap);
+	off_t fileOffset = offset;
+	jlong numBytesSent = 0;
+	ssize_t numBytesWritten;
 
-	// Infinite blocking mode specified, don't return until we have completely finished the read
-	if ((timeoutMode == j_extensions_comm_SerialComm_TIMEOUT_READ_BLOCKING) && (readTimeout == 0))
+	while (numBytesSent < length)
 	{
-		// While there are more bytes we are supposed to read
-		while (bytesRemaining > 0)
+		int chunkSize = ((length - numBytesSent) > 65536) ? 65536 : (int)(length - numBytesSent);
+		if (useSendfile)
 		{
-			if ((numBytesRead = read(serialPortFD, readBuffer+index, bytesRemaining)) == -1)
-			{
-				// Problem reading, close port
-				close(serialPortFD);
-				serialPortFD = -1;
-				env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-				env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
-				break;
-			}
-
-			// Fix index variables
-			index += numBytesRead;
-			bytesRemaining -= numBytesRead;
+			if ((numBytesWritten = sendfile(port->portFD, fileFD, &fileOffset, chunkSize)) > 0)
+				numBytesSent += numBytesWritten;
+			else if ((numBytesWritten == -1) && ((errno == EINVAL) || (errno == ENOSYS)) && (numBytesSent == 0))
+				useSendfile = false;
+			else if (((numBytesWritten == -1) && (errno != EAGAIN) && (errno != EINTR)) || (waitForPort(port, POLLOUT, -1) == -1))
+				return TRANSFER_PORT_ERROR;
+		}
+		else
+		{
+			// Fall back to writing straight out of the memory-mapped file, which still avoids any copies through the Java heap
+			if ((numBytesWritten = writeToJavaPort(env, obj, port, fileData + numBytesSent, chunkSize)) == -1)
+				return TRANSFER_PORT_ERROR;
+			numBytesSent += numBytesWritten;
 		}
+		updateTransferProgress(env, obj, port->portFD, numBytesSent);
+	}
 
-		// Set return values
-		env->ReleaseByteArrayElements(buffer, readBuffer, 0);
-		numBytesRead = bytesToRead;
+	// Wait for the output queue to drain, sleeping for roughly the time it takes to transmit what is left
+	int bytesWaiting = 0;
+	jlong charTime = getCharacterTime(&config);
+	while ((ioctl(port->portFD, TIOCOUTQ, &bytesWaiting) == 0) && (bytesWaiting > 0))
+	{
+		if (waitForPort(port, 0, ((bytesWaiting > 64) ? 64 : bytesWaiting) * charTime) == -1)
+			return TRANSFER_PORT_ERROR;
+		updateTransferProgress(env, obj, port->portFD, numBytesSent);
 	}
-	else if (timeoutMode == j_extensions_comm_SerialComm_TIMEOUT_READ_BLOCKING)		// Blocking mode, but not indefinitely
+	if (drainOutput(port, charTime) == -1)
+		return TRANSFER_PORT_ERROR;
+	updateTransferProgress(env, obj, -1, numBytesSent);
+	return numBytesSent;
+}
+
+// Waits for a single control character from a file transfer receiver, returning it or one of the transfer error codes
+static int readControlCharacter(SerialPortHandle *port, jlong timeoutNanos)
+{
+	unsigned char reply;
+	int waitResult, numBytesRead;
+	jlong expireTime = getMonotonicTime() + timeoutNanos, waitTime;
+
+	while (true)
 	{
-		// Get current system time
-		struct timeval expireTime, currTime;
-		gettimeofday(&expireTime, NULL);
-		expireTime.tv_usec += (readTimeout * 1000);
-		if (expireTime.tv_usec > 1000000)
-		{
-			expireTime.tv_sec += (expireTime.tv_usec * 0.000001);
-			expireTime.tv_usec = (expireTime.tv_usec % 1000000);
-		}
+		waitTime = expireTime - getMonotonicTime();
+		if ((waitResult = waitForPort(port, POLLIN, (waitTime < 0) ? 0 : waitTime)) == 0)
+			return TRANSFER_TIMEOUT;
+		else if ((waitResult == -1) || ((numBytesRead = read(port->portFD, &reply, 1)) == 0) ||
+				((numBytesRead == -1) && (errno != EAGAIN) && (errno != EINTR)))
+			return TRANSFER_PORT_ERROR;
+		else if (numBytesRead == 1)
+			return reply;
+	}
+}
+
+// Waits for the receiver to request the next transfer with 'C' (CRC mode) or NAK (checksum mode), returning the request
+static int waitForReceiver(SerialPortHandle *port)
+{
+	jlong expireTime = getMonotonicTime() + 60000000000ll;
+	int reply, numCancels = 0;
+	while (getMonotonicTime() < expireTime)
+	{
+		if (((reply = readControlCharacter(port, expireTime - getMonotonicTime())) == 'C') || (reply == XMODEM_NAK) || (reply == TRANSFER_PORT_ERROR))
+			return reply;
+		else if ((reply == XMODEM_CAN) && (++numCancels == 2))
+			return TRANSFER_ABORTED;
+		else if (reply != XMODEM_CAN)
+			numCancels = 0;
+	}
+	return TRANSFER_TIMEOUT;
+}
+
+// Calculates the CRC-16/XMODEM checksum of a block of data
+static unsigned short calculateCrc16(const unsigned char *data, int length)
+{
+	unsigned short crc = 0;
+	for (int i = 0; i < length; ++i)
+	{
+		crc ^= (unsigned short)(data[i] << 8);
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc & 0x8000) ? (unsigned short)((crc << 1) ^ 0x1021) : (unsigned short)(crc << 1);
+	}
+	return crc;
+}
+
+// Sends a single XMODEM/YMODEM block, retransmitting it until the receiver acknowledges it
+static int sendXmodemBlock(JNIEnv *env, jobject obj, SerialPortHandle *port, unsigned char blockNumber, const unsigned char *data, int dataLength, int blockSize, unsigned char padding, bool useCrc)
+{
+	// Build the block: header, block number and its complement, padded data, and CRC or arithmetic checksum
+	unsigned char block[3 + 1024 + 2];
+	int blockLength = 3 + blockSize, reply;
+	block[0] = (blockSize == 1024) ? XMODEM_STX : XMODEM_SOH;
+	block[1] = blockNumber;
+	block[2] = (unsigned char)~blockNumber;
+	memcpy(block + 3, data, dataLength);
+	memset(block + 3 + dataLength, padding, blockSize - dataLength);
+	if (useCrc)
+	{
+		unsigned short crc = calculateCrc16(block + 3, blockSize);
+		block[blockLength++] = (unsigned char)(crc >> 8);
+		block[blockLength++] = (unsigned char)crc;
+	}
+	else
+	{
+		unsigned char checksum = 0;
+		for (int i = 0; i < blockSize; ++i)
+			checksum += block[3 + i];
+		block[blockLength++] = checksum;
+	}
 
-		// While there are more bytes we are supposed to read and the timeout has not elapsed
+	for (int retry = 0, numCancels = 0; retry < XMODEM_MAX_RETRIES; ++retry)
+	{
+		// Discard any line noise, then transmit the block and wait for the receiver's verdict
+		tcflush(port->portFD, TCIFLUSH);
+		if (writeToJavaPort(env, obj, port, block, blockLength) != blockLength)
+			return TRANSFER_PORT_ERROR;
 		do
 		{
-			if ((numBytesRead = read(serialPortFD, readBuffer+index, bytesRemaining)) == -1)
-			{
-				// Problem reading, close port
-				close(serialPortFD);
-				serialPortFD = -1;
-				env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-				env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
-				break;
-			}
+			if (((reply = readControlCharacter(port, 10000000000ll)) == XMODEM_ACK) || (reply == TRANSFER_PORT_ERROR))
+				return (reply == XMODEM_ACK) ? 0 : reply;
+			numCancels = (reply == XMODEM_CAN) ? (numCancels + 1) : 0;
+		} while (numCancels == 1);
+		if (numCancels == 2)
+			return TRANSFER_ABORTED;
+	}
+	return TRANSFER_ABORTED;
+}
+
+// Sends a file region using the XMODEM, XMODEM-1K, or YMODEM block-acknowledged protocols
+static jlong sendFileXmodem(JNIEnv *env, jobject obj, SerialPortHandle *port, const char *fileName, const unsigned char *fileData, jlong length, int protocol)
+{
+	bool isYmodem = (protocol == j_extensions_comm_SerialComm_FILE_TRANSFER_YMODEM);
+	unsigned char header[1024], eot = XMODEM_EOT;
+	int request, result, blockSize, dataLength;
+	unsigned char blockNumber = 1;
+
+	// Wait for the receiver to start the transfer, which also selects between CRC and checksum mode
+	if ((request = waitForReceiver(port)) < 0)
+		return request;
+	bool useCrc = (request == 'C');
+
+	// YMODEM begins with block 0, which contains the file name and size, after which the receiver requests the data again
+	if (isYmodem)
+	{
+		const char *baseName = strrchr(fileName, '/') ? (strrchr(fileName, '/') + 1) : fileName;
+		memset(header, 0, sizeof(header));
+		strncpy((char*)header, baseName, sizeof(header) - 32);
+		dataLength = strlen((char*)header) + 1;
+		dataLength += sprintf((char*)header + dataLength, "%lld", (long long)length) + 1;
+		if (((result = sendXmodemBlock(env, obj, port, 0, header, dataLength, (dataLength > 128) ? 1024 : 128, 0, useCrc)) < 0) ||
+				((request = waitForReceiver(port)) < 0))
+			return (result < 0) ? result : request;
+	}
+
+	// Send the data, using 1 kB blocks if the protocol and receiver allow it, but not wasting one on a short final block
+	for (jlong position = 0; position < length; position += dataLength, ++blockNumber)
+	{
+		blockSize = ((protocol != j_extensions_comm_SerialComm_FILE_TRANSFER_XMODEM) && useCrc && ((length - position) > 128)) ? 1024 : 128;
+		dataLength = ((length - position) > blockSize) ? blockSize : (int)(length - position);
+		if ((result = sendXmodemBlock(env, obj, port, blockNumber, fileData + position, dataLength, blockSize, 0x1A, useCrc)) < 0)
+			return result;
+		env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "fileBytesSent", "J"), position + dataLength);
+	}
+
+	// Signal the end of the file until the receiver acknowledges it
+	for (int retry = 0; ; ++retry)
+	{
+		if ((retry == XMODEM_MAX_RETRIES) || (writeToJavaPort(env, obj, port, &eot, 1) != 1))
+			return (retry == XMODEM_MAX_RETRIES) ? TRANSFER_ABORTED : TRANSFER_PORT_ERROR;
+		if (((result = readControlCharacter(port, 10000000000ll)) == XMODEM_ACK) || (result == XMODEM_CAN) || (result == TRANSFER_PORT_ERROR))
+			break;
+	}
+	if (result != XMODEM_ACK)
+		return (result == XMODEM_CAN) ? TRANSFER_ABORTED : result;
+
+	// YMODEM ends the batch with an empty block 0
+	if (isYmodem)
+	{
+		memset(header, 0, 128);
+		if (((request = waitForReceiver(port)) < 0) || ((result = sendXmodemBlock(env, obj, port, 0, header, 128, 128, 0, useCrc)) < 0))
+			return (request < 0) ? request : result;
+	}
+	return length;
+}
+
+// Shared memory layout of a port broker: this header, followed by the receive ring and then the transmit ring.
+// The single publisher reserves ring space before overwriting it, so readers can detect data that changed underneath them.
+typedef struct BrokerSharedState
+{
+	unsigned int magic, ringSize, writeRingSize, brokerClosed;
+	unsigned int publishSequence, writeRequestSequence, writeCompleteSequence, reserved;
+	unsigned long long reservePosition, publishPosition, writeHead, writeTail;
+	pthread_mutex_t writeMutex;
+} BrokerSharedState;
+
+// Process-local view of a port broker, used both by the owning process and by attached clients
+typedef struct PortBrokerState
+{
+	BrokerSharedState *shared;
+	unsigned char *ring, *writeRing;
+	size_t mapLength;
+	unsigned long long readPosition, numBytesLost;
+	int stopEventFD;
+	bool isOwner;
+	char shmName[256];
+} PortBrokerState;
+
+// Waits on a shared futex word for as long as it holds the expected value, with an optional relative timeout in nanoseconds
+static void futexWait(unsigned int *address, unsigned int expectedValue, jlong timeoutNanos)
+{
+	struct timespec waitTime = { (time_t)(timeoutNanos / 1000000000ll), (long)(timeoutNanos % 1000000000ll) };
+	syscall(SYS_futex, address, FUTEX_WAIT, expectedValue, (timeoutNanos < 0) ? NULL : &waitTime, NULL, 0);
+}
+
+// Advances a shared sequence counter and wakes every process waiting on it
+static void futexWakeAll(unsigned int *address)
+{
+	__atomic_add_fetch(address, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, address, FUTEX_WAKE, 0x7FFFFFFF, NULL, NULL, 0);
+}
+
+// Maps an existing or newly created broker shared memory object into this process
+static PortBrokerState* mapPortBroker(const char *name, bool create, unsigned int ringSize, unsigned int writeRingSize)
+{
+	PortBrokerState *broker = (PortBrokerState*)calloc(1, sizeof(PortBrokerState));
+	snprintf(broker->shmName, sizeof(broker->shmName), "/serialcomm-%s", name);
+	broker->isOwner = create;
+	broker->stopEventFD = -1;
+
+	// Replace any stale object left behind by a broker that was not shut down cleanly
+	if (create)
+		shm_unlink(broker->shmName);
+	int shmFD = shm_open(broker->shmName, create ? (O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC) : (O_RDWR | O_CLOEXEC), 0660);
+	struct stat shmInfo;
+	if ((shmFD == -1) || (create && (ftruncate(shmFD, BROKER_HEADER_SIZE + ringSize + writeRingSize) != 0)) || (fstat(shmFD, &shmInfo) != 0) ||
+			(shmInfo.st_size < BROKER_HEADER_SIZE))
+	{
+		if (shmFD != -1)
+			close(shmFD);
+		if (create && (shmFD != -1))
+			shm_unlink(broker->shmName);
+		free(broker);
+		return NULL;
+	}
+	broker->mapLength = shmInfo.st_size;
+	void *sharedMemory = mmap(NULL, broker->mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, shmFD, 0);
+	close(shmFD);
+	if (sharedMemory == MAP_FAILED)
+	{
+		if (create)
+			shm_unlink(broker->shmName);
+		free(broker);
+		return NULL;
+	}
+	broker->shared = (BrokerSharedState*)sharedMemory;
+
+	// Initialize the shared state, using a robust mutex so that a client dying mid-write cannot block the others forever
+	if (create)
+	{
+		pthread_mutexattr_t mutexAttributes;
+		pthread_mutexattr_init(&mutexAttributes);
+		pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&broker->shared->writeMutex, &mutexAttributes);
+		pthread_mutexattr_destroy(&mutexAttributes);
+		broker->shared->ringSize = ringSize;
+		broker->shared->writeRingSize = writeRingSize;
+		broker->stopEventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		__atomic_store_n(&broker->shared->magic, BROKER_MAGIC, __ATOMIC_RELEASE);
+	}
+	else if ((__atomic_load_n(&broker->shared->magic, __ATOMIC_ACQUIRE) != BROKER_MAGIC) ||
+			(broker->mapLength < (BROKER_HEADER_SIZE + (size_t)broker->shared->ringSize + broker->shared->writeRingSize)))
+	{
+		munmap(sharedMemory, broker->mapLength);
+		free(broker);
+		return NULL;
+	}
+	broker->ring = (unsigned char*)sharedMemory + BROKER_HEADER_SIZE;
+	broker->writeRing = broker->ring + broker->shared->ringSize;
+	broker->readPosition = __atomic_load_n(&broker->shared->publishPosition, __ATOMIC_ACQUIRE);
+	registerNativeBuffer(sharedMemory, broker->mapLength);
+	return broker;
+}
 
-			// Fix index variables
-			index += numBytesRead;
-			bytesRemaining -= numBytesRead;
+// Marks the broker as closed and wakes up every reader and writer in every attached process
+static void closePortBroker(BrokerSharedState *shared)
+{
+	__atomic_store_n(&shared->brokerClosed, 1, __ATOMIC_RELEASE);
+	futexWakeAll(&shared->publishSequence);
+	futexWakeAll(&shared->writeRequestSequence);
+	futexWakeAll(&shared->writeCompleteSequence);
+}
+
+// Native Aho-Corasick automaton for a set of expected responses, stored as a complete DFA followed in memory by its tables.
+// For every state, the longest pattern ending there and the minimum number of bytes needed to complete any pattern are kept,
+// so the port is never read past the end of a match and unmatched data stays queued for the next read.
+typedef struct ExpectAutomaton
+{
+	int numStates;
+	int *transitions, *matchingPattern, *bytesToMatch;
+} ExpectAutomaton;
 
-			// Get current system time
-			gettimeofday(&currTime, NULL);
-		} while ((bytesRemaining > 0) && ((expireTime.tv_sec > currTime.tv_sec) ||
-				((expireTime.tv_sec == currTime.tv_sec) && (expireTime.tv_usec > currTime.tv_usec))));
+// Builds the automaton for the specified patterns, returning NULL if there is not enough memory
+static ExpectAutomaton* buildExpectAutomaton(unsigned char **patterns, const int *patternLengths, int numPatterns)
+{
+	// Allocate enough states for a trie with no shared prefixes
+	int maxStates = 1, numStates = 1;
+	for (int i = 0; i < numPatterns; ++i)
+		maxStates += patternLengths[i];
+	ExpectAutomaton *automaton = (ExpectAutomaton*)malloc(sizeof(ExpectAutomaton) + (maxStates * (256 + 2) * sizeof(int)));
+	int *failureLinks = (int*)malloc(maxStates * 4 * sizeof(int));
+	if ((automaton == NULL) || (failureLinks == NULL))
+	{
+		free(automaton);
+		free(failureLinks);
+		return NULL;
+	}
+	automaton->transitions = (int*)(automaton + 1);
+	automaton->matchingPattern = automaton->transitions + (maxStates * 256);
+	automaton->bytesToMatch = automaton->matchingPattern + maxStates;
+	int *parents = failureLinks + maxStates, *subtreeDistances = parents + maxStates, *stateQueue = subtreeDistances + maxStates;
+	memset(automaton->transitions, 0xFF, maxStates * 256 * sizeof(int));
+	memset(automaton->matchingPattern, 0xFF, maxStates * sizeof(int));
 
-		// Set return values
-		env->ReleaseByteArrayElements(buffer, readBuffer, 0);
-		numBytesRead = index;
+	// Insert every pattern into the trie, keeping the lowest index for duplicates
+	parents[0] = 0;
+	for (int i = 0; i < numPatterns; ++i)
+	{
+		int state = 0;
+		for (int j = 0; j < patternLengths[i]; ++j)
+		{
+			int *transition = &automaton->transitions[(state * 256) + patterns[i][j]];
+			if (*transition == -1)
+			{
+				parents[numStates] = state;
+				*transition = numStates++;
+			}
+			state = *transition;
+		}
+		if ((patternLengths[i] > 0) && (automaton->matchingPattern[state] == -1))
+			automaton->matchingPattern[state] = i;
 	}
-	else		// Timeouts or non-blocking specified
+
+	// Compute failure links breadth-first, completing the transition table and inheriting matches of shorter suffixes
+	int queueHead = 0, queueTail = 0;
+	failureLinks[0] = 0;
+	for (int c = 0; c < 256; ++c)
 	{
-		// Read from port
-		if ((numBytesRead = read(serialPortFD, readBuffer, bytesToRead)) > -1)
-			env->ReleaseByteArrayElements(buffer, readBuffer, 0);
+		int *transition = &automaton->transitions[c];
+		if (*transition == -1)
+			*transition = 0;
 		else
 		{
-			// Problem reading, close port
-			close(serialPortFD);
-			serialPortFD = -1;
-			env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-			env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
+			failureLinks[*transition] = 0;
+			stateQueue[queueTail++] = *transition;
+		}
+	}
+	while (queueHead < queueTail)
+	{
+		int state = stateQueue[queueHead++];
+		if (automaton->matchingPattern[state] == -1)
+			automaton->matchingPattern[state] = automaton->matchingPattern[failureLinks[state]];
+		for (int c = 0; c < 256; ++c)
+		{
+			int *transition = &automaton->transitions[(state * 256) + c];
+			int fallback = automaton->transitions[(failureLinks[state] * 256) + c];
+			if (*transition == -1)
+				*transition = fallback;
+			else
+			{
+				failureLinks[*transition] = fallback;
+				stateQueue[queueTail++] = *transition;
+			}
 		}
 	}
 
-	// Return number of bytes read if successful
-	return numBytesRead;
+	// Find the shortest completion of a pattern below each trie node, then the shortest one reachable through any suffix
+	for (int i = 0; i < numStates; ++i)
+		subtreeDistances[i] = ((automaton->matchingPattern[i] != -1) && (i != 0)) ? 0 : 0x7FFFFFFF;
+	for (int i = queueTail - 1; i >= 0; --i)
+		if ((subtreeDistances[stateQueue[i]] != 0x7FFFFFFF) && (subtreeDistances[stateQueue[i]] + 1 < subtreeDistances[parents[stateQueue[i]]]))
+			subtreeDistances[parents[stateQueue[i]]] = subtreeDistances[stateQueue[i]] + 1;
+	automaton->bytesToMatch[0] = subtreeDistances[0];
+	for (int i = 0; i < queueTail; ++i)
+		automaton->bytesToMatch[stateQueue[i]] = (subtreeDistances[stateQueue[i]] < automaton->bytesToMatch[failureLinks[stateQueue[i]]]) ?
+				subtreeDistances[stateQueue[i]] : automaton->bytesToMatch[failureLinks[stateQueue[i]]];
+
+	automaton->numStates = numStates;
+	free(failureLinks);
+	return automaton;
 }
 
-JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jlong bytesToWrite)
+// Watches every existing directory on the way to a device path, since udev may recreate any of them when the device reappears
+static void watchDeviceDirectories(int inotifyFD, const char *identity)
 {
-	jbyte *writeBuffer = env->GetByteArrayElements(buffer, 0);
-	int serialPortFD = (int)env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
-	int numBytesWritten;
-
-	// Write to port
-	if ((numBytesWritten = write(serialPortFD, writeBuffer, bytesToWrite)) == -1)
+	char directory[PATH_MAX], *separator;
+	snprintf(directory, sizeof(directory), "%s", identity);
+	while (((separator = strrchr(directory, '/')) != NULL) && (separator != directory))
 	{
-		// Problem writing, close port
-		close(serialPortFD);
-		serialPortFD = -1;
-		env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"), -1l);
-		env->SetBooleanField(obj, env->GetFieldID(env->GetObjectClass(obj), "isOpened", "Z"), JNI_FALSE);
+		*separator = '\0';
+		inotify_add_watch(inotifyFD, directory, IN_CREATE | IN_MOVED_TO | IN_ATTRIB | IN_ONLYDIR);
 	}
+}
 
-	// Return number of bytes written if successful
-	return numBytesWritten;
+// Native slab backing a pool of receive buffers, each of which starts on its own cache line
+typedef struct ReceiveBufferPool
+{
+	int numBuffers, bufferSize, bufferStride;
+	size_t slabSize;
+	unsigned char *slab;
+} ReceiveBufferPool;
+
+JNIEXPORT jobjectArray JNICALL Java_j_extensions_comm_SerialComm_getCommPorts(JNIEnv *env, jclass serialCommClass)
+{
+	// Get relevant SerialComm methods and IDs
+	jmethodID serialCommConstructor = env->GetMethodID(serialCommClass, "<init>", "()V");
+	jfieldID portStringID = env->GetFieldID(serialCommClass, "portString", "Ljava/lang/String;");
+	jfieldID comPortID = env->GetFieldID(serialCommClass, "comPort", "Ljava/lang/String;");
+
+	// Enumerate serial ports on machine
+	SerialPortInfo *portList;
+	int numPorts = enumerateSerialPorts(&portList);
+	if (numPorts < 0)
+		return NULL;
+	jobjectArray arrayObject = env->NewObjectArray(numPorts, serialCommClass, 0);
+	for (int i = 0; i < numPorts; ++i)
+	{
+		// Create new SerialComm object containing the enumerated values
+		jobject serialCommObject = env->NewObject(serialCommClass, serialCommConstructor);
+		env->SetObjectField(serialCommObject, portStringID, env->NewStringUTF(portList[i].portName));
+		env->SetObjectField(serialCommObject, comPortID, env->NewStringUTF(portList[i].systemPath));
+
+		// Add new SerialComm object to array
+		env->SetObjectArrayElement(arrayObject, i, serialCommObject);
+	}
+	free(portList);
+
+	return arrayObject;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_openPort(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jstring portNameJString = (jstring)env->GetObjectField(obj, env->GetFieldID(serialCommClass, "comPort", "Ljava/lang/String;"));
+	const char *portName = env->GetStringUTFChars(portNameJString, NULL);
+	SerialPortConfig config;
+
+	// Try to open and configure the serial port, then set the port handle in Java structure
+	getPortConfig(env, obj, &config);
+	jlong portHandle = openSerialPort(portName, &config);
+	env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485Emulated", "Z"), config.rs485Emulated ? JNI_TRUE : JNI_FALSE);
+	env->SetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"), portHandle);
+	env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "isOpened", "Z"), (portHandle == -1l) ? JNI_FALSE : JNI_TRUE);
+	if (portHandle != -1l)
+	{
+		// Remember which physical device was opened so that it can be found again if it is unplugged
+		char deviceIdentity[PATH_MAX];
+		findDeviceIdentity(portName, deviceIdentity, sizeof(deviceIdentity));
+		env->SetObjectField(obj, env->GetFieldID(serialCommClass, "deviceIdentity", "Ljava/lang/String;"), env->NewStringUTF(deviceIdentity));
+		if (env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "autoReconnect", "Z")))
+			env->CallVoidMethod(obj, env->GetMethodID(serialCommClass, "startConnectionMonitor", "()V"));
+	}
+
+	env->ReleaseStringUTFChars(portNameJString, portName);
+	return (jboolean)traceCall(TRACE_OPEN_PORT, portHandle, 0, (portHandle == -1l) ? JNI_FALSE : JNI_TRUE, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configPort(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	SerialPortConfig config;
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jboolean)traceCall(TRACE_CONFIG_PORT, portHandle, 0, JNI_FALSE, traceStart);
+
+	// Apply the port parameters from Java class
+	getPortConfig(env, obj, &config);
+	bool success = configurePortParameters(port, &config);
+	releasePortHandle(port);
+	return (jboolean)traceCall(TRACE_CONFIG_PORT, portHandle, 0, success ? JNI_TRUE : JNI_FALSE, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configFlowControl(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	SerialPortConfig config;
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jboolean)traceCall(TRACE_CONFIG_FLOW_CONTROL, portHandle, 0, JNI_FALSE, traceStart);
+
+	// Apply the flow control settings from Java class
+	getPortConfig(env, obj, &config);
+	bool success = configureFlowControl(port, &config);
+	releasePortHandle(port);
+	return (jboolean)traceCall(TRACE_CONFIG_FLOW_CONTROL, portHandle, 0, success ? JNI_TRUE : JNI_FALSE, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configTimeouts(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	SerialPortConfig config;
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jboolean)traceCall(TRACE_CONFIG_TIMEOUTS, portHandle, 0, JNI_FALSE, traceStart);
+
+	// Apply the port timeouts from Java class
+	getPortConfig(env, obj, &config);
+	bool success = configureTimeouts(port, &config);
+	releasePortHandle(port);
+	return (jboolean)traceCall(TRACE_CONFIG_TIMEOUTS, portHandle, 0, success ? JNI_TRUE : JNI_FALSE, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configRs485(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	SerialPortConfig config;
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jboolean)traceCall(TRACE_CONFIG_RS485, portHandle, 0, JNI_FALSE, traceStart);
+
+	// Apply the RS-485 parameters from Java class, noting whether writes must control the transmitter themselves
+	getPortConfig(env, obj, &config);
+	bool success = configureRs485(port, &config);
+	env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "rs485Emulated", "Z"), config.rs485Emulated ? JNI_TRUE : JNI_FALSE);
+	releasePortHandle(port);
+	return (jboolean)traceCall(TRACE_CONFIG_RS485, portHandle, 0, success ? JNI_TRUE : JNI_FALSE, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_closePort(JNIEnv *env, jobject obj)
+{
+	// Detach the port from the Java object first, so that calls failing because of the close do not trigger a reconnect
+	jlong traceStart = traceBegin();
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jfieldID portHandleID = env->GetFieldID(serialCommClass, "portHandle", "J");
+	jlong portHandle = env->GetLongField(obj, portHandleID);
+	env->SetLongField(obj, portHandleID, -1l);
+	env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "reconnecting", "Z"), JNI_FALSE);
+	env->SetBooleanField(obj, env->GetFieldID(serialCommClass, "isOpened", "Z"), JNI_FALSE);
+
+	// Close port, waking up any calls that are blocked on it
+	closePortHandle(portHandle);
+
+	return (jboolean)traceCall(TRACE_CLOSE_PORT, portHandle, 0, JNI_TRUE, traceStart);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_bytesAvailable(JNIEnv *env, jobject obj)
+{
+	jlong traceStart = traceBegin();
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	int numBytesAvailable = -1;
+
+	if (port != NULL)
+	{
+		numBytesAvailable = getBytesAvailable(port);
+		releasePortHandle(port);
+	}
+
+	return (jint)traceCall(TRACE_BYTES_AVAILABLE, portHandle, 0, numBytesAvailable, traceStart);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jlong bytesToRead)
+{
+	// Get port handle and read timeout from Java class
+	jlong traceStart = traceBegin();
+	jclass serialCommClass = env->GetObjectClass(obj);
+	int timeoutMode = env->GetIntField(obj, env->GetFieldID(serialCommClass, "timeoutMode", "I"));
+	int readTimeout = env->GetIntField(obj, env->GetFieldID(serialCommClass, "readTimeout", "I"));
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jint)traceCall(TRACE_READ_BYTES, portHandle, bytesToRead, -1, traceStart);
+
+	// Read from port directly into the Java array
+	jbyte *readBuffer = env->GetByteArrayElements(buffer, 0);
+	int numBytesRead = readFromPort(port, readBuffer, bytesToRead, timeoutMode, readTimeout);
+	env->ReleaseByteArrayElements(buffer, readBuffer, 0);
+	releasePortHandle(port);
+
+	// Problem reading, close port
+	if (numBytesRead == -1)
+		closeJavaPort(env, obj, portHandle);
+
+	// Return number of bytes read if successful
+	return (jint)traceCall(TRACE_READ_BYTES, portHandle, bytesToRead, numBytesRead, traceStart);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readAvailableBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jint offset, jint bytesToRead)
+{
+	// Get port handle from Java class
+	jlong traceStart = traceBegin();
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jint)traceCall(TRACE_READ_AVAILABLE_BYTES, portHandle, bytesToRead, -1, traceStart);
+	jbyte readBuffer[4096];
+	if (bytesToRead > (jint)sizeof(readBuffer))
+		bytesToRead = sizeof(readBuffer);
+
+	// Sleep in the kernel until data arrives or the port is closed, independent of the configured timeout mode
+	int numBytesRead = readAvailableFromPort(port, readBuffer, bytesToRead);
+	releasePortHandle(port);
+	if (numBytesRead > 0)
+		env->SetByteArrayRegion(buffer, offset, numBytesRead, readBuffer);
+	else
+		closeJavaPort(env, obj, portHandle);
+	return (jint)traceCall(TRACE_READ_AVAILABLE_BYTES, portHandle, bytesToRead, numBytesRead, traceStart);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jlong bytesToWrite)
+{
+	// Queue the data instead of writing it while the port is being reconnected
+	jlong traceStart = traceBegin();
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jmethodID queueMethodID = env->GetMethodID(serialCommClass, "queueForReconnect", "([BJ)I");
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	int numBytesWritten;
+	if (env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "reconnecting", "Z")) &&
+			((numBytesWritten = env->CallIntMethod(obj, queueMethodID, buffer, bytesToWrite)) != -2))
+		return (jint)traceCall(TRACE_WRITE_BYTES, portHandle, bytesToWrite, numBytesWritten, traceStart);
+
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jint)traceCall(TRACE_WRITE_BYTES, portHandle, bytesToWrite, -1, traceStart);
+	jbyte *writeBuffer = env->GetByteArrayElements(buffer, 0);
+
+	// Write to port
+	numBytesWritten = writeToJavaPort(env, obj, port, writeBuffer, bytesToWrite);
+	env->ReleaseByteArrayElements(buffer, writeBuffer, JNI_ABORT);
+	releasePortHandle(port);
+
+	// Problem writing, close port and keep the data for the reconnected device if auto-reconnect is enabled
+	if (numBytesWritten == -1)
+	{
+		closeJavaPort(env, obj, portHandle);
+		if (env->GetBooleanField(obj, env->GetFieldID(serialCommClass, "reconnecting", "Z")) &&
+				(env->CallIntMethod(obj, queueMethodID, buffer, bytesToWrite) >= 0))
+			numBytesWritten = bytesToWrite;
+	}
+
+	// Return number of bytes written if successful
+	return (jint)traceCall(TRACE_WRITE_BYTES, portHandle, bytesToWrite, numBytesWritten, traceStart);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytesToPorts(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jbyteArray buffer, jlong bytesToWrite, jintArray bytesWritten, jlongArray writeTimes)
+{
+	if (!isArrayRegionValid(env, buffer, 0, bytesToWrite))
+		return 0;
+	jfieldID portHandleID = env->GetFieldID(serialCommClass, "portHandle", "J");
+	int numPorts = env->GetArrayLength(ports), numSuccessful = 0, writeResult;
+	jlong *portHandleValues = (jlong*)malloc(numPorts * sizeof(jlong)), interByteGap, interFrameGap;
+	SerialPortHandle **portHandleList = (SerialPortHandle**)malloc(numPorts * sizeof(SerialPortHandle*));
+	jint *numBytesWritten = (jint*)malloc(numPorts * sizeof(jint));
+	jlong *completionTimes = (jlong*)malloc(numPorts * sizeof(jlong));
+	bool *fullWritePath = (bool*)malloc(numPorts * sizeof(bool));
+	SerialPortConfig config;
+
+	// Take a reference to every port up front so that the writes can be issued back-to-back, noting the ports whose writes must
+	// control an emulated RS-485 transmitter or be paced, since those can only go through the same path as writeBytes()
+	for (int i = 0; i < numPorts; ++i)
+	{
+		jobject port = env->GetObjectArrayElement(ports, i);
+		portHandleValues[i] = env->GetLongField(port, portHandleID);
+		portHandleList[i] = acquirePortHandle(portHandleValues[i]);
+		numBytesWritten[i] = (portHandleList[i] == NULL) ? -1 : 0;
+		getPortConfig(env, port, &config);
+		fullWritePath[i] = config.rs485Emulated || getPacingGaps(&config, &interByteGap, &interFrameGap);
+		env->DeleteLocalRef(port);
+	}
+
+	// Retrieve the data once and hand it to every plain port without waiting, then finish any ports whose output queues were full
+	// and write to the remaining ports one at a time
+	jbyte *writeBuffer = env->GetByteArrayElements(buffer, 0);
+	for (int i = 0; i < numPorts; ++i)
+		if ((portHandleList[i] == NULL) || fullWritePath[i])
+			continue;
+		else if ((writeResult = write(portHandleList[i]->portFD, writeBuffer, bytesToWrite)) >= 0)
+			numBytesWritten[i] = writeResult;
+		else if ((errno != EAGAIN) && (errno != EINTR))
+			numBytesWritten[i] = -1;
+	for (int i = 0; i < numPorts; ++i)
+	{
+		if ((portHandleList[i] != NULL) && fullWritePath[i])
+		{
+			jobject port = env->GetObjectArrayElement(ports, i);
+			numBytesWritten[i] = writeToJavaPort(env, port, portHandleList[i], writeBuffer, bytesToWrite);
+			env->DeleteLocalRef(port);
+		}
+		else while ((numBytesWritten[i] != -1) && (numBytesWritten[i] < bytesToWrite))
+		{
+			if ((writeResult = write(portHandleList[i]->portFD, writeBuffer + numBytesWritten[i], bytesToWrite - numBytesWritten[i])) > 0)
+				numBytesWritten[i] += writeResult;
+			else if (((writeResult == -1) && (errno != EAGAIN) && (errno != EINTR)) || (waitForPort(portHandleList[i], POLLOUT, -1) == -1))
+				numBytesWritten[i] = -1;
+		}
+		completionTimes[i] = getMonotonicTime();
+		if (numBytesWritten[i] == bytesToWrite)
+			++numSuccessful;
+	}
+	env->ReleaseByteArrayElements(buffer, writeBuffer, JNI_ABORT);
+
+	// Release every port, closing any that had problems writing
+	for (int i = 0; i < numPorts; ++i)
+		if (portHandleList[i] != NULL)
+		{
+			releasePortHandle(portHandleList[i]);
+			if (numBytesWritten[i] == -1)
+			{
+				jobject port = env->GetObjectArrayElement(ports, i);
+				closeJavaPort(env, port, portHandleValues[i]);
+				env->DeleteLocalRef(port);
+			}
+		}
+
+	// Return per-port results
+	env->SetIntArrayRegion(bytesWritten, 0, numPorts, numBytesWritten);
+	env->SetLongArrayRegion(writeTimes, 0, numPorts, completionTimes);
+	free(fullWritePath);
+	free(completionTimes);
+	free(numBytesWritten);
+	free(portHandleList);
+	free(portHandleValues);
+	return numSuccessful;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readBytesFromPorts(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jbyteArray buffer, jint bytesPerPort, jintArray bytesRead, jlongArray arrivalTimes, jint timeout)
+{
+	jfieldID portHandleID = env->GetFieldID(serialCommClass, "portHandle", "J");
+	int numPorts = env->GetArrayLength(ports), numReady = 0, numOpened = 0, pollResult;
+	jlong *portHandleValues = (jlong*)malloc(numPorts * sizeof(jlong));
+	SerialPortHandle **portHandleList = (SerialPortHandle**)malloc(numPorts * sizeof(SerialPortHandle*));
+	struct pollfd *waitingSet = (struct pollfd*)malloc(2 * numPorts * sizeof(struct pollfd));
+	jint *numBytesRead = (jint*)calloc(numPorts, sizeof(jint));
+	jlong *receiveTimes = (jlong*)calloc(numPorts, sizeof(jlong));
+	jbyte *readBuffer = (jbyte*)malloc(bytesPerPort);
+	jlong currTime, waitTime, expireTime = getMonotonicTime() + (timeout * 1000000ll);
+	struct timespec waitTimeSpec;
+
+	// Take a reference to every open port and wait on both its data and its close notification
+	for (int i = 0; i < numPorts; ++i)
+	{
+		jobject port = env->GetObjectArrayElement(ports, i);
+		portHandleValues[i] = env->GetLongField(port, portHandleID);
+		portHandleList[i] = acquirePortHandle(portHandleValues[i]);
+		waitingSet[i].fd = (portHandleList[i] == NULL) ? -1 : portHandleList[i]->portFD;
+		waitingSet[numPorts + i].fd = (portHandleList[i] == NULL) ? -1 : portHandleList[i]->eventFD;
+		waitingSet[i].events = waitingSet[numPorts + i].events = POLLIN;
+		numOpened += (portHandleList[i] == NULL) ? 0 : 1;
+		env->DeleteLocalRef(port);
+	}
+
+	while ((numReady == 0) && (numOpened > 0))
+	{
+		// Wait for data on any port
+		waitTime = expireTime - getMonotonicTime();
+		if ((timeout != 0) && (waitTime <= 0))
+			break;
+		waitTimeSpec.tv_sec = (time_t)(waitTime / 1000000000ll);
+		waitTimeSpec.tv_nsec = (long)(waitTime % 1000000000ll);
+		if (((pollResult = ppoll(waitingSet, 2 * numPorts, (timeout == 0) ? NULL : &waitTimeSpec, NULL)) == 0) ||
+				((pollResult == -1) && (errno == EINTR)))
+			continue;
+		else if (pollResult == -1)
+			break;
+
+		// Read from every port that has data available
+		currTime = getMonotonicTime();
+		for (int i = 0; i < numPorts; ++i)
+		{
+			if ((waitingSet[i].revents == 0) && (waitingSet[numPorts + i].revents == 0))
+				continue;
+			if ((waitingSet[numPorts + i].revents == 0) && (waitingSet[i].revents & POLLIN) &&
+					((numBytesRead[i] = read(waitingSet[i].fd, readBuffer, bytesPerPort)) > 0))
+			{
+				env->SetByteArrayRegion(buffer, i * bytesPerPort, numBytesRead[i], readBuffer);
+				receiveTimes[i] = currTime;
+				++numReady;
+			}
+			else if (waitingSet[numPorts + i].revents || (waitingSet[i].revents & (POLLERR | POLLHUP | POLLNVAL)) ||
+					((numBytesRead[i] == -1) && (errno != EAGAIN) && (errno != EINTR)))
+			{
+				// Port closed or failed, stop waiting on it
+				waitingSet[i].fd = waitingSet[numPorts + i].fd = -1;
+				numBytesRead[i] = -1;
+				--numOpened;
+			}
+			else
+				numBytesRead[i] = 0;
+		}
+	}
+
+	// Release every port, closing any that had problems reading
+	for (int i = 0; i < numPorts; ++i)
+		if (portHandleList[i] != NULL)
+		{
+			releasePortHandle(portHandleList[i]);
+			if (numBytesRead[i] == -1)
+			{
+				jobject port = env->GetObjectArrayElement(ports, i);
+				closeJavaPort(env, port, portHandleValues[i]);
+				env->DeleteLocalRef(port);
+			}
+		}
+
+	// Return per-port results
+	env->SetIntArrayRegion(bytesRead, 0, numPorts, numBytesRead);
+	env->SetLongArrayRegion(arrivalTimes, 0, numPorts, receiveTimes);
+	free(readBuffer);
+	free(receiveTimes);
+	free(numBytesRead);
+	free(waitingSet);
+	free(portHandleList);
+	free(portHandleValues);
+	return ((numReady == 0) && (numOpened == 0)) ? -1 : numReady;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_executeTransactionCycles(JNIEnv *env, jobject obj, jobject schedule, jobject results, jint numCycles)
+{
+	// Get port parameters from Java class
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return 0;
+	int serialPortFD = port->portFD;
+	SerialPortConfig config;
+	getPortConfig(env, obj, &config);
+	jlong charTime = getCharacterTime(&config);
+
+	// Get transaction schedule from Java class, defaulting to a 3.5-character inter-frame gap
+	jclass scheduleClass = env->GetObjectClass(schedule);
+	int numTransactions = env->GetIntField(schedule, env->GetFieldID(scheduleClass, "numTransactions", "I"));
+	jlong interFrameGap = env->GetIntField(schedule, env->GetFieldID(scheduleClass, "interFrameGap", "I")) * 1000ll;
+	jlong cyclePeriod = env->GetIntField(schedule, env->GetFieldID(scheduleClass, "cyclePeriod", "I")) * 1000ll;
+	jbyteArray requestDataArray = (jbyteArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "requestData", "[B"));
+	jbyteArray prefixDataArray = (jbyteArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "prefixData", "[B"));
+	jintArray requestOffsetsArray = (jintArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "requestOffsets", "[I"));
+	jintArray prefixOffsetsArray = (jintArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "prefixOffsets", "[I"));
+	jintArray responseOffsetsArray = (jintArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "responseOffsets", "[I"));
+	jintArray expectedLengthsArray = (jintArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "expectedLengths", "[I"));
+	jintArray timeoutsArray = (jintArray)env->GetObjectField(schedule, env->GetFieldID(scheduleClass, "timeouts", "[I"));
+	if (interFrameGap <= 0)
+		interFrameGap = (charTime * 7) / 2;
+
+	// Copy the schedule into native memory so that no JNI calls are needed while it is running
+	jint *requestOffsets = (jint*)malloc((numTransactions + 1) * sizeof(jint));
+	jint *prefixOffsets = (jint*)malloc((numTransactions + 1) * sizeof(jint));
+	jint *responseOffsets = (jint*)malloc((numTransactions + 1) * sizeof(jint));
+	jint *expectedLengths = (jint*)malloc((numTransactions + 1) * sizeof(jint));
+	jint *timeouts = (jint*)malloc((numTransactions + 1) * sizeof(jint));
+	env->GetIntArrayRegion(requestOffsetsArray, 0, numTransactions + 1, requestOffsets);
+	env->GetIntArrayRegion(prefixOffsetsArray, 0, numTransactions + 1, prefixOffsets);
+	env->GetIntArrayRegion(responseOffsetsArray, 0, numTransactions + 1, responseOffsets);
+	env->GetIntArrayRegion(expectedLengthsArray, 0, numTransactions, expectedLengths);
+	env->GetIntArrayRegion(timeoutsArray, 0, numTransactions, timeouts);
+	jbyte *requestData = (jbyte*)malloc(requestOffsets[numTransactions] + 1);
+	jbyte *prefixData = (jbyte*)malloc(prefixOffsets[numTransactions] + 1);
+	env->GetByteArrayRegion(requestDataArray, 0, requestOffsets[numTransactions], requestData);
+	env->GetByteArrayRegion(prefixDataArray, 0, prefixOffsets[numTransactions], prefixData);
+
+	// Allocate native result storage for all cycles
+	int responseSize = responseOffsets[numTransactions], numResults = numCycles * numTransactions;
+	jbyte *responseData = (jbyte*)calloc((numCycles * responseSize) + 1, 1);
+	jint *responseLengths = (jint*)calloc(numResults + 1, sizeof(jint));
+	jint *statuses = (jint*)calloc(numResults + 1, sizeof(jint));
+	jlong *responseTimes = (jlong*)calloc(numResults + 1, sizeof(jlong));
+	jlong *cycleStartTimes = (jlong*)calloc(numCycles + 1, sizeof(jlong));
+	jlong *cycleDurations = (jlong*)calloc(numCycles + 1, sizeof(jlong));
+
+	// Run the whole schedule natively
+	jlong firstCycleStart = getMonotonicTime(), lastBusActivity = 0, requestTime, expireTime, waitTime, currTime;
+	int cycle, waitResult, numBytesRead = 0;
+	bool portError = false;
+	for (cycle = 0; (cycle < numCycles) && !portError; ++cycle)
+	{
+		// Wait until the scheduled start of this cycle
+		if (cyclePeriod > 0)
+			sleepUntil(firstCycleStart + (cycle * cyclePeriod));
+		cycleStartTimes[cycle] = getMonotonicTime();
+
+		for (int i = 0; (i < numTransactions) && !portError; ++i)
+		{
+			int resultIndex = (cycle * numTransactions) + i, numReceived = 0;
+			int requestLength = requestOffsets[i+1] - requestOffsets[i], prefixLength = prefixOffsets[i+1] - prefixOffsets[i];
+			int maxResponseLength = responseOffsets[i+1] - responseOffsets[i];
+			jbyte *response = responseData + (cycle * responseSize) + responseOffsets[i];
+
+			// Enforce the inter-frame silent interval and discard any stale data
+			sleepUntil(lastBusActivity + interFrameGap);
+			tcflush(serialPortFD, TCIFLUSH);
+
+			// Send the request and wait until it has physically left the port, which a concurrent close can interrupt
+			requestTime = getMonotonicTime();
+			if ((writeToJavaPort(env, obj, port, requestData + requestOffsets[i], requestLength) != requestLength) || (drainOutput(port, charTime) == -1))
+			{
+				statuses[resultIndex] = j_extensions_comm_SerialComm_TRANSACTION_ERROR;
+				portError = true;
+				break;
+			}
+			currTime = lastBusActivity = getMonotonicTime();
+			expireTime = currTime + (timeouts[i] * 1000000ll);
+
+			// Receive until the expected length, an inter-frame silence, or the timeout is reached
+			while (numReceived < maxResponseLength)
+			{
+				waitTime = expireTime - currTime;
+				if ((numReceived > 0) && (expectedLengths[i] <= 0) && ((lastBusActivity + interFrameGap - currTime) < waitTime))
+					waitTime = lastBusActivity + interFrameGap - currTime;
+				if (waitTime <= 0)
+					break;
+				waitResult = waitForPort(port, POLLIN, waitTime);
+				currTime = getMonotonicTime();
+				if ((waitResult == 0) || ((waitResult == 1) && ((numBytesRead = read(serialPortFD, response + numReceived, maxResponseLength - numReceived)) == -1) &&
+						((errno == EAGAIN) || (errno == EINTR))))
+					continue;
+				else if ((waitResult == -1) || (numBytesRead <= 0))
+				{
+					portError = true;
+					break;
+				}
+				numReceived += numBytesRead;
+				lastBusActivity = currTime;
+				if ((expectedLengths[i] > 0) && (numReceived >= expectedLengths[i]))
+					break;
+			}
+
+			// Classify the response
+			responseLengths[resultIndex] = numReceived;
+			responseTimes[resultIndex] = lastBusActivity - requestTime;
+			if (portError)
+				statuses[resultIndex] = j_extensions_comm_SerialComm_TRANSACTION_ERROR;
+			else if ((numReceived == 0) || (numReceived < expectedLengths[i]))
+				statuses[resultIndex] = j_extensions_comm_SerialComm_TRANSACTION_TIMEOUT;
+			else if ((numReceived < prefixLength) || (memcmp(response, prefixData + prefixOffsets[i], prefixLength) != 0))
+				statuses[resultIndex] = j_extensions_comm_SerialComm_TRANSACTION_MISMATCH;
+			else
+				statuses[resultIndex] = j_extensions_comm_SerialComm_TRANSACTION_OK;
+		}
+		cycleDurations[cycle] = getMonotonicTime() - cycleStartTimes[cycle];
+	}
+
+	// Problem communicating, close port
+	releasePortHandle(port);
+	if (portError)
+		closeJavaPort(env, obj, portHandle);
+
+	// Deliver all results to Java in a single batch
+	jclass resultsClass = env->GetObjectClass(results);
+	env->SetByteArrayRegion((jbyteArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "responseData", "[B")), 0, numCycles * responseSize, responseData);
+	env->SetIntArrayRegion((jintArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "responseLengths", "[I")), 0, numResults, responseLengths);
+	env->SetIntArrayRegion((jintArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "statuses", "[I")), 0, numResults, statuses);
+	env->SetLongArrayRegion((jlongArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "responseTimes", "[J")), 0, numResults, responseTimes);
+	env->SetLongArrayRegion((jlongArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "cycleStartTimes", "[J")), 0, numCycles, cycleStartTimes);
+	env->SetLongArrayRegion((jlongArray)env->GetObjectField(results, env->GetFieldID(resultsClass, "cycleDurations", "[J")), 0, numCycles, cycleDurations);
+
+	// Clean up
+	free(cycleDurations);
+	free(cycleStartTimes);
+	free(responseTimes);
+	free(statuses);
+	free(responseLengths);
+	free(responseData);
+	free(prefixData);
+	free(requestData);
+	free(timeouts);
+	free(expectedLengths);
+	free(responseOffsets);
+	free(prefixOffsets);
+	free(requestOffsets);
+
+	// Return the number of cycles which ran to completion
+	return portError ? (cycle - 1) : cycle;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_applyRealtimeParameters(JNIEnv *env, jobject obj)
+{
+	return applyRealtimeSettings(env, obj) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_measureWakeupLatencies(JNIEnv *env, jobject obj, jobject histogram, jint numSamples, jint interval)
+{
+	// Run the measurement under the same conditions as this port's I/O, restoring the thread's own settings afterwards
+	ThreadSchedulingState originalScheduling;
+	saveThreadScheduling(&originalScheduling);
+	jboolean realtimeApplied = applyRealtimeSettings(env, obj) ? JNI_TRUE : JNI_FALSE;
+	jclass histogramClass = env->GetObjectClass(histogram);
+	jintArray bucketCountsArray = (jintArray)env->GetObjectField(histogram, env->GetFieldID(histogramClass, "bucketCounts", "[I"));
+	int numBuckets = env->GetArrayLength(bucketCountsArray);
+	jint *bucketCounts = (jint*)calloc(numBuckets, sizeof(jint));
+	jlong minLatency = 0, maxLatency = 0, totalLatency = 0, latency, currTime;
+
+	// Repeatedly sleep until an absolute deadline and record how late each wakeup was, in one-microsecond buckets
+	jlong wakeTime = getMonotonicTime();
+	for (int i = 0; i < numSamples; ++i)
+	{
+		wakeTime += interval * 1000ll;
+		sleepUntil(wakeTime);
+		currTime = getMonotonicTime();
+		latency = (currTime > wakeTime) ? (currTime - wakeTime) : 0;
+		++bucketCounts[((latency / 1000) < numBuckets) ? (latency / 1000) : (numBuckets - 1)];
+		minLatency = ((i == 0) || (latency < minLatency)) ? latency : minLatency;
+		maxLatency = (latency > maxLatency) ? latency : maxLatency;
+		totalLatency += latency;
+
+		// Don't try to catch up on missed deadlines, since that would produce a burst of artificially short wakeups
+		if (latency > (interval * 1000ll))
+			wakeTime = currTime;
+	}
+
+	restoreThreadScheduling(&originalScheduling);
+
+	// Return the histogram to Java
+	env->SetIntArrayRegion(bucketCountsArray, 0, numBuckets, bucketCounts);
+	env->SetIntField(histogram, env->GetFieldID(histogramClass, "numSamples", "I"), numSamples);
+	env->SetLongField(histogram, env->GetFieldID(histogramClass, "minLatency", "J"), minLatency);
+	env->SetLongField(histogram, env->GetFieldID(histogramClass, "maxLatency", "J"), maxLatency);
+	env->SetLongField(histogram, env->GetFieldID(histogramClass, "totalLatency", "J"), totalLatency);
+	free(bucketCounts);
+	return realtimeApplied;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createGnssParser(JNIEnv *env, jclass serialCommClass, jobject messageBuffer, jint maxMessageLength)
+{
+	// Keep track of both the parser state and the message buffer it decodes into, so that they can be locked into memory
+	GnssParserState *parser = (GnssParserState*)calloc(1, sizeof(GnssParserState) + maxMessageLength);
+	if (parser != NULL)
+	{
+		parser->maxMessageLength = maxMessageLength;
+		parser->messageBuffer = env->GetDirectBufferAddress(messageBuffer);
+		registerNativeBuffer(parser, sizeof(GnssParserState) + maxMessageLength);
+		registerNativeBuffer(parser->messageBuffer, (size_t)env->GetDirectBufferCapacity(messageBuffer));
+	}
+	return (jlong)parser;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyGnssParser(JNIEnv *env, jclass serialCommClass, jlong parserState)
+{
+	GnssParserState *parser = (GnssParserState*)parserState;
+	unregisterNativeBuffer(parser->messageBuffer);
+	unregisterNativeBuffer(parser);
+	free(parser);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_parseGnssData(JNIEnv *env, jclass serialCommClass, jobject parserObj, jbyteArray data, jint offset, jint length)
+{
+	// Get parser state and output buffer from Java class
+	if (!isArrayRegionValid(env, data, offset, length))
+		return 0;
+	jclass parserClass = env->GetObjectClass(parserObj);
+	GnssParserState *parser = (GnssParserState*)env->GetLongField(parserObj, env->GetFieldID(parserClass, "parserState", "J"));
+	jobject outputBuffer = env->GetObjectField(parserObj, env->GetFieldID(parserClass, "messageBuffer", "Ljava/nio/ByteBuffer;"));
+	unsigned char *output = (unsigned char*)env->GetDirectBufferAddress(outputBuffer);
+	int outputCapacity = (int)env->GetDirectBufferCapacity(outputBuffer), outputLength = 0, numMessages = 0;
+
+	// Parse directly out of the Java array without copying it
+	unsigned char *inputData = (unsigned char*)env->GetPrimitiveArrayCritical(data, NULL);
+	int numBytesConsumed = parseGnssBytes(parser, inputData + offset, length, output, outputCapacity, &outputLength, &numMessages, getMonotonicTime());
+	env->ReleasePrimitiveArrayCritical(data, inputData, JNI_ABORT);
+
+	updateGnssParser(env, parserObj, parser, outputLength, numMessages);
+	return numBytesConsumed;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readGnssData(JNIEnv *env, jobject obj, jobject parserObj, jint timeout)
+{
+	// Get port handle from Java class
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return -1;
+
+	// Get parser state and output buffer from Java class
+	jclass parserClass = env->GetObjectClass(parserObj);
+	GnssParserState *parser = (GnssParserState*)env->GetLongField(parserObj, env->GetFieldID(parserClass, "parserState", "J"));
+	jobject outputBuffer = env->GetObjectField(parserObj, env->GetFieldID(parserClass, "messageBuffer", "Ljava/nio/ByteBuffer;"));
+	unsigned char *output = (unsigned char*)env->GetDirectBufferAddress(outputBuffer);
+	int outputCapacity = (int)env->GetDirectBufferCapacity(outputBuffer), outputLength = 0, numMessages = 0, numBytesRead = 0, waitResult;
+	jlong expireTime = getMonotonicTime() + (timeout * 1000000ll), waitTime, readTime = getMonotonicTime();
+
+	// Finish parsing any data left over from the previous call before reading more
+	parser->inputStart += parseGnssBytes(parser, parser->inputBuffer + parser->inputStart, parser->inputEnd - parser->inputStart,
+			output, outputCapacity, &outputLength, &numMessages, readTime);
+	while ((numMessages == 0) && (parser->inputStart == parser->inputEnd))
+	{
+		// Wait for more data to arrive, blocking indefinitely if no timeout was specified
+		waitTime = expireTime - getMonotonicTime();
+		if ((waitResult = waitForPort(port, POLLIN, (timeout == 0) ? -1 : (waitTime < 0) ? 0 : waitTime)) == 0)
+			break;
+		else if ((waitResult == -1) || ((numBytesRead = read(port->portFD, parser->inputBuffer, sizeof(parser->inputBuffer))) == 0) ||
+				((numBytesRead == -1) && (errno != EAGAIN) && (errno != EINTR)))
+		{
+			numBytesRead = -1;
+			break;
+		}
+
+		// Parse everything that was just received
+		readTime = getMonotonicTime();
+		parser->inputStart = 0;
+		parser->inputEnd = (numBytesRead > 0) ? numBytesRead : 0;
+		parser->inputStart += parseGnssBytes(parser, parser->inputBuffer, parser->inputEnd, output, outputCapacity, &outputLength, &numMessages, readTime);
+	}
+	releasePortHandle(port);
+
+	// Problem reading, close port
+	updateGnssParser(env, parserObj, parser, outputLength, numMessages);
+	if (numBytesRead == -1)
+	{
+		closeJavaPort(env, obj, portHandle);
+		return -1;
+	}
+	return numMessages;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_transmitFile(JNIEnv *env, jobject obj, jstring fileName, jlong offset, jlong length, jint protocol)
+{
+	// Get port handle from Java class
+	jlong traceStart = traceBegin();
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jlong)traceCall(TRACE_TRANSMIT_FILE, portHandle, length, TRANSFER_PORT_ERROR, traceStart);
+
+	// Open the file and determine the region to send
+	const char *fileNameString = env->GetStringUTFChars(fileName, NULL);
+	int fileFD = open(fileNameString, O_RDONLY | O_CLOEXEC);
+	struct stat fileInfo;
+	if ((fileFD == -1) || (fstat(fileFD, &fileInfo) != 0) || (offset < 0) || (offset > fileInfo.st_size))
+	{
+		if (fileFD != -1)
+			close(fileFD);
+		env->ReleaseStringUTFChars(fileName, fileNameString);
+		releasePortHandle(port);
+		return (jlong)traceCall(TRACE_TRANSMIT_FILE, portHandle, length, TRANSFER_FILE_ERROR, traceStart);
+	}
+	if ((length < 0) || (length > (fileInfo.st_size - offset)))
+		length = fileInfo.st_size - offset;
+	env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "fileBytesSent", "J"), 0);
+	env->SetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "fileBytesTotal", "J"), length);
+
+	// Map the requested region of the file, starting from a page boundary
+	jlong mapOffset = offset & ~((jlong)sysconf(_SC_PAGESIZE) - 1);
+	size_t mapLength = (size_t)(length + (offset - mapOffset));
+	void *fileMap = (length > 0) ? mmap(NULL, mapLength, PROT_READ, MAP_SHARED, fileFD, mapOffset) : NULL;
+	jlong result = TRANSFER_FILE_ERROR;
+	if (fileMap != MAP_FAILED)
+	{
+		const unsigned char *fileData = (const unsigned char*)fileMap + (offset - mapOffset);
+		if (fileMap != NULL)
+		{
+			madvise(fileMap, mapLength, MADV_SEQUENTIAL);
+			madvise(fileMap, mapLength, MADV_WILLNEED);
+		}
+		if (protocol == j_extensions_comm_SerialComm_FILE_TRANSFER_RAW)
+			result = streamFileToPort(env, obj, port, fileFD, fileData, offset, length);
+		else
+			result = sendFileXmodem(env, obj, port, fileNameString, fileData, length, protocol);
+		if (fileMap != NULL)
+			munmap(fileMap, mapLength);
+	}
+	close(fileFD);
+	env->ReleaseStringUTFChars(fileName, fileNameString);
+	releasePortHandle(port);
+
+	// Problem writing, close port
+	if (result == TRANSFER_PORT_ERROR)
+		closeJavaPort(env, obj, portHandle);
+	return (jlong)traceCall(TRACE_TRANSMIT_FILE, portHandle, length, result, traceStart);
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createPortBroker(JNIEnv *env, jclass serialCommClass, jstring brokerName, jint ringSize, jint writeRingSize)
+{
+	const char *name = env->GetStringUTFChars(brokerName, NULL);
+	PortBrokerState *broker = mapPortBroker(name, true, (unsigned int)ringSize, (unsigned int)writeRingSize);
+	env->ReleaseStringUTFChars(brokerName, name);
+	return (jlong)broker;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_attachPortBroker(JNIEnv *env, jclass serialCommClass, jstring brokerName)
+{
+	const char *name = env->GetStringUTFChars(brokerName, NULL);
+	PortBrokerState *broker = mapPortBroker(name, false, 0, 0);
+	env->ReleaseStringUTFChars(brokerName, name);
+	return (jlong)broker;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_stopPortBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+	// Wake up the publishing and transmitting threads of the owning process so that they return
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	closePortBroker(broker->shared);
+	eventfd_write(broker->stopEventFD, 1);
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_detachPortBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+	// Only the owner removes the shared memory object, attached clients keep their mappings until they detach
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	if (broker->isOwner)
+	{
+		closePortBroker(broker->shared);
+		shm_unlink(broker->shmName);
+		close(broker->stopEventFD);
+	}
+	unregisterNativeBuffer(broker->shared);
+	munmap(broker->shared, broker->mapLength);
+	free(broker);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_publishToBroker(JNIEnv *env, jobject obj, jlong brokerState)
+{
+	// Get port handle from Java class
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	BrokerSharedState *shared = broker->shared;
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+	{
+		closePortBroker(shared);
+		return -1;
+	}
+	prepareServiceThread(env, obj);
+
+	struct pollfd waitingSet[3] = { { port->portFD, POLLIN, 0 }, { port->eventFD, POLLIN, 0 }, { broker->stopEventFD, POLLIN, 0 } };
+	unsigned long long writePosition = shared->publishPosition;
+	int pollResult, numBytesRead = 0;
+	while (!__atomic_load_n(&shared->brokerClosed, __ATOMIC_ACQUIRE))
+	{
+		// Wait for data, a port close, or a broker shutdown
+		if (((pollResult = poll(waitingSet, 3, -1)) == -1) && (errno == EINTR))
+			continue;
+		else if (waitingSet[2].revents)
+			break;
+		else if ((pollResult == -1) || waitingSet[1].revents || ((waitingSet[0].revents & POLLIN) == 0))
+		{
+			numBytesRead = -1;
+			break;
+		}
+
+		// Reserve the ring space about to be overwritten, then let the kernel copy the data straight into shared memory
+		unsigned int ringOffset = (unsigned int)(writePosition % shared->ringSize);
+		unsigned int chunkSize = shared->ringSize - ringOffset;
+		if (chunkSize > BROKER_MAX_READ_CHUNK)
+			chunkSize = BROKER_MAX_READ_CHUNK;
+		__atomic_store_n(&shared->reservePosition, writePosition + chunkSize, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		if ((numBytesRead = read(port->portFD, broker->ring + ringOffset, chunkSize)) > 0)
+		{
+			// Publish the new data to every reader
+			writePosition += numBytesRead;
+			__atomic_store_n(&shared->publishPosition, writePosition, __ATOMIC_RELEASE);
+			__atomic_store_n(&shared->reservePosition, writePosition, __ATOMIC_RELEASE);
+			futexWakeAll(&shared->publishSequence);
+		}
+		else if ((numBytesRead == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+		{
+			numBytesRead = -1;
+			break;
+		}
+	}
+	releasePortHandle(port);
+
+	// Problem reading, close port and let all clients know that no more data will arrive
+	if (numBytesRead == -1)
+	{
+		closePortBroker(shared);
+		closeJavaPort(env, obj, portHandle);
+		return -1;
+	}
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_transmitFromBroker(JNIEnv *env, jobject obj, jlong brokerState)
+{
+	// Get port handle from Java class
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	BrokerSharedState *shared = broker->shared;
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+	{
+		closePortBroker(shared);
+		return -1;
+	}
+	prepareServiceThread(env, obj);
+
+	int numBytesWritten = 0;
+	while (!__atomic_load_n(&shared->brokerClosed, __ATOMIC_ACQUIRE))
+	{
+		// Sleep until a client queues data for transmission
+		unsigned int requestSequence = __atomic_load_n(&shared->writeRequestSequence, __ATOMIC_ACQUIRE);
+		unsigned long long writeHead = __atomic_load_n(&shared->writeHead, __ATOMIC_ACQUIRE), writeTail = shared->writeTail;
+		if (writeHead == writeTail)
+		{
+			futexWait(&shared->writeRequestSequence, requestSequence, -1);
+			continue;
+		}
+
+		// Transmit the next contiguous block of queued data, then hand the space back to the clients
+		unsigned int ringOffset = (unsigned int)(writeTail % shared->writeRingSize);
+		unsigned int chunkSize = shared->writeRingSize - ringOffset;
+		if (chunkSize > (writeHead - writeTail))
+			chunkSize = (unsigned int)(writeHead - writeTail);
+		if ((numBytesWritten = writeToJavaPort(env, obj, port, broker->writeRing + ringOffset, chunkSize)) == -1)
+			break;
+		__atomic_store_n(&shared->writeTail, writeTail + chunkSize, __ATOMIC_RELEASE);
+		futexWakeAll(&shared->writeCompleteSequence);
+	}
+	releasePortHandle(port);
+
+	// Problem writing, close port and let all clients know that the broker is gone
+	if (numBytesWritten == -1)
+	{
+		closePortBroker(shared);
+		closeJavaPort(env, obj, portHandle);
+		return -1;
+	}
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_brokerBytesAvailable(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	unsigned long long publishPosition = __atomic_load_n(&broker->shared->publishPosition, __ATOMIC_ACQUIRE);
+	unsigned long long numBytesAvailable = publishPosition - broker->readPosition;
+	return (numBytesAvailable > broker->shared->ringSize) ? broker->shared->ringSize : (jint)numBytesAvailable;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readFromBroker(JNIEnv *env, jclass serialCommClass, jobject clientObj, jbyteArray buffer, jint offset, jint length, jint timeout)
+{
+	// Get broker state from Java class
+	jclass clientClass = env->GetObjectClass(clientObj);
+	PortBrokerState *broker = (PortBrokerState*)env->GetLongField(clientObj, env->GetFieldID(clientClass, "brokerState", "J"));
+	BrokerSharedState *shared = broker->shared;
+	if (!isArrayRegionValid(env, buffer, offset, length))
+		return -1;
+	jlong expireTime = getMonotonicTime() + (timeout * 1000000ll), waitTime;
+	int numBytesRead = 0;
+
+	while (numBytesRead == 0)
+	{
+		unsigned int publishSequence = __atomic_load_n(&shared->publishSequence, __ATOMIC_ACQUIRE);
+		unsigned long long publishPosition = __atomic_load_n(&shared->publishPosition, __ATOMIC_ACQUIRE);
+		if (publishPosition != broker->readPosition)
+		{
+			// Skip ahead if this reader fell so far behind that its data has already been overwritten
+			if ((publishPosition - broker->readPosition) > shared->ringSize)
+			{
+				broker->numBytesLost += publishPosition - shared->ringSize - broker->readPosition;
+				broker->readPosition = publishPosition - shared->ringSize;
+			}
+
+			// Copy straight from shared memory into the Java array, handling wraparound at the end of the ring
+			int numBytesToCopy = ((publishPosition - broker->readPosition) < (unsigned long long)length) ? (int)(publishPosition - broker->readPosition) : length;
+			unsigned int ringOffset = (unsigned int)(broker->readPosition % shared->ringSize);
+			unsigned int firstChunk = ((shared->ringSize - ringOffset) < (unsigned int)numBytesToCopy) ? (shared->ringSize - ringOffset) : numBytesToCopy;
+			unsigned char *readBuffer = (unsigned char*)env->GetPrimitiveArrayCritical(buffer, NULL);
+			memcpy(readBuffer + offset, broker->ring + ringOffset, firstChunk);
+			memcpy(readBuffer + offset + firstChunk, broker->ring, numBytesToCopy - firstChunk);
+			env->ReleasePrimitiveArrayCritical(buffer, readBuffer, 0);
+
+			// Discard the copy if the publisher started overwriting any of it in the meantime
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			unsigned long long reservePosition = __atomic_load_n(&shared->reservePosition, __ATOMIC_RELAXED);
+			if ((reservePosition - broker->readPosition) > shared->ringSize)
+			{
+				broker->numBytesLost += reservePosition - shared->ringSize - broker->readPosition;
+				broker->readPosition = reservePosition - shared->ringSize;
+				continue;
+			}
+			broker->readPosition += numBytesToCopy;
+			numBytesRead = numBytesToCopy;
+		}
+		else if (__atomic_load_n(&shared->brokerClosed, __ATOMIC_ACQUIRE))
+			numBytesRead = -1;
+		else
+		{
+			// Sleep until the publisher signals new data, blocking indefinitely if no timeout was specified
+			waitTime = expireTime - getMonotonicTime();
+			if ((timeout != 0) && (waitTime <= 0))
+				break;
+			futexWait(&shared->publishSequence, publishSequence, (timeout == 0) ? -1 : waitTime);
+		}
+	}
+
+	env->SetLongField(clientObj, env->GetFieldID(clientClass, "numBytesLost", "J"), broker->numBytesLost);
+	return numBytesRead;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeToBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState, jbyteArray buffer, jint offset, jint length)
+{
+	PortBrokerState *broker = (PortBrokerState*)brokerState;
+	BrokerSharedState *shared = broker->shared;
+	if (!isArrayRegionValid(env, buffer, offset, length))
+		return -1;
+	jbyte *writeBuffer = env->GetByteArrayElements(buffer, 0);
+	int numBytesQueued = 0;
+
+	// Serialize clients so that each write reaches the port as one uninterrupted block
+	if (pthread_mutex_lock(&shared->writeMutex) == EOWNERDEAD)
+		pthread_mutex_consistent(&shared->writeMutex);
+	while ((numBytesQueued < length) && !__atomic_load_n(&shared->brokerClosed, __ATOMIC_ACQUIRE))
+	{
+		// Wait for the broker to free up space in the transmit ring if it is full
+		unsigned int completeSequence = __atomic_load_n(&shared->writeCompleteSequence, __ATOMIC_ACQUIRE);
+		unsigned long long writeHead = shared->writeHead, writeTail = __atomic_load_n(&shared->writeTail, __ATOMIC_ACQUIRE);
+		unsigned int spaceAvailable = shared->writeRingSize - (unsigned int)(writeHead - writeTail);
+		if (spaceAvailable == 0)
+		{
+			futexWait(&shared->writeCompleteSequence, completeSequence, -1);
+			continue;
+		}
+
+		// Queue as much as fits contiguously and wake the broker
+		unsigned int ringOffset = (unsigned int)(writeHead % shared->writeRingSize);
+		unsigned int chunkSize = shared->writeRingSize - ringOffset;
+		if (chunkSize > spaceAvailable)
+			chunkSize = spaceAvailable;
+		if (chunkSize > (unsigned int)(length - numBytesQueued))
+			chunkSize = length - numBytesQueued;
+		memcpy(broker->writeRing + ringOffset, writeBuffer + offset + numBytesQueued, chunkSize);
+		__atomic_store_n(&shared->writeHead, writeHead + chunkSize, __ATOMIC_RELEASE);
+		futexWakeAll(&shared->writeRequestSequence);
+		numBytesQueued += chunkSize;
+	}
+	pthread_mutex_unlock(&shared->writeMutex);
+	env->ReleaseByteArrayElements(buffer, writeBuffer, JNI_ABORT);
+
+	// Return the number of bytes queued for transmission, or -1 if the broker has shut down
+	return (numBytesQueued < length) ? -1 : numBytesQueued;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createExpectAutomaton(JNIEnv *env, jclass serialCommClass, jobjectArray patterns)
+{
+	// Copy all patterns out of their Java arrays
+	int numPatterns = env->GetArrayLength(patterns);
+	unsigned char **patternData = (unsigned char**)calloc(numPatterns + 1, sizeof(unsigned char*));
+	int *patternLengths = (int*)calloc(numPatterns + 1, sizeof(int));
+	bool patternsCopied = (patternData != NULL) && (patternLengths != NULL);
+	for (int i = 0; patternsCopied && (i < numPatterns); ++i)
+	{
+		jbyteArray pattern = (jbyteArray)env->GetObjectArrayElement(patterns, i);
+		patternLengths[i] = env->GetArrayLength(pattern);
+		if ((patternData[i] = (unsigned char*)malloc(patternLengths[i] + 1)) == NULL)
+			patternsCopied = false;
+		else
+			env->GetByteArrayRegion(pattern, 0, patternLengths[i], (jbyte*)patternData[i]);
+		env->DeleteLocalRef(pattern);
+	}
+
+	// Build the automaton and free the temporary copies
+	ExpectAutomaton *automaton = patternsCopied ? buildExpectAutomaton(patternData, patternLengths, numPatterns) : NULL;
+	for (int i = 0; (patternData != NULL) && (i < numPatterns); ++i)
+		free(patternData[i]);
+	free(patternData);
+	free(patternLengths);
+	return (jlong)automaton;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyExpectAutomaton(JNIEnv *env, jclass serialCommClass, jlong automatonState)
+{
+	free((ExpectAutomaton*)automatonState);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readUntilMatch(JNIEnv *env, jobject obj, jobject patternsObj, jobject resultObj, jint timeout)
+{
+	// Get port handle from Java class
+	jlong traceStart = traceBegin();
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jint)traceCall(TRACE_READ_UNTIL_MATCH, portHandle, timeout, -2, traceStart);
+
+	// Get automaton from Java class and allocate space for the consumed data
+	ExpectAutomaton *automaton = (ExpectAutomaton*)env->GetLongField(patternsObj, env->GetFieldID(env->GetObjectClass(patternsObj), "automatonState", "J"));
+	int dataCapacity = 256, dataLength = 0, numBytesRead = 0, state = 0, matchingPattern = -1, waitResult;
+	unsigned char *data = (unsigned char*)malloc(dataCapacity), *resizedData;
+	jlong expireTime = getMonotonicTime() + (timeout * 1000000ll), waitTime;
+
+	while ((matchingPattern == -1) && (data != NULL))
+	{
+		// Wait for more data to arrive, blocking indefinitely if no timeout was specified
+		waitTime = expireTime - getMonotonicTime();
+		if ((waitResult = waitForPort(port, POLLIN, (timeout == 0) ? -1 : (waitTime < 0) ? 0 : waitTime)) == 0)
+			break;
+		else if (waitResult == -1)
+		{
+			numBytesRead = -1;
+			break;
+		}
+
+		// Read only as many bytes as could possibly be needed to complete a match, so nothing after it is consumed
+		int bytesToRead = (automaton->bytesToMatch[state] > 4096) ? 4096 : (automaton->bytesToMatch[state] < 1) ? 1 : automaton->bytesToMatch[state];
+		if (dataLength + bytesToRead > dataCapacity)
+		{
+			dataCapacity = (2 * dataCapacity) + bytesToRead;
+			if ((resizedData = (unsigned char*)realloc(data, dataCapacity)) == NULL)
+				break;
+			data = resizedData;
+		}
+		if (((numBytesRead = read(port->portFD, data + dataLength, bytesToRead)) == 0) || ((numBytesRead == -1) && (errno != EAGAIN) && (errno != EINTR)))
+		{
+			numBytesRead = -1;
+			break;
+		}
+		else if (numBytesRead == -1)
+		{
+			// Spurious wakeup, which must not be mistaken for a failed read if the timeout expires next
+			numBytesRead = 0;
+			continue;
+		}
+
+		// Feed the new bytes through the automaton
+		for (int i = 0; (i < numBytesRead) && (matchingPattern == -1); ++i)
+			matchingPattern = automaton->matchingPattern[state = automaton->transitions[(state * 256) + data[dataLength + i]]];
+		dataLength += numBytesRead;
+	}
+	releasePortHandle(port);
+
+	// Return the consumed data to Java
+	jbyteArray consumedData = env->NewByteArray(dataLength);
+	if (dataLength > 0)
+		env->SetByteArrayRegion(consumedData, 0, dataLength, (const jbyte*)data);
+	env->SetObjectField(resultObj, env->GetFieldID(env->GetObjectClass(resultObj), "data", "[B"), consumedData);
+	free(data);
+
+	// Problem reading, close port
+	if (numBytesRead == -1)
+	{
+		closeJavaPort(env, obj, portHandle);
+		return (jint)traceCall(TRACE_READ_UNTIL_MATCH, portHandle, timeout, -2, traceStart);
+	}
+	return (jint)traceCall(TRACE_READ_UNTIL_MATCH, portHandle, timeout, matchingPattern, traceStart);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_waitForHangup(JNIEnv *env, jobject obj)
+{
+	// Get port handle from Java class
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return JNI_FALSE;
+
+	// Sleep until the device hangs up or the port is closed, without requesting any events that would report normal I/O
+	struct pollfd waitingSet[2] = { { port->portFD, 0, 0 }, { port->eventFD, POLLIN, 0 } };
+	while ((ppoll(waitingSet, 2, NULL, NULL) == -1) && (errno == EINTR));
+	bool hungUp = !waitingSet[1].revents && (waitingSet[0].revents & (POLLHUP | POLLERR | POLLNVAL));
+	releasePortHandle(port);
+
+	// Close the port, which starts reconnecting it if enabled
+	if (hungUp)
+		closeJavaPort(env, obj, portHandle);
+	return hungUp ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jstring JNICALL Java_j_extensions_comm_SerialComm_waitForDevice(JNIEnv *env, jclass serialCommClass, jstring deviceIdentity, jint timeout)
+{
+	// Watch the directories leading to the device for new entries
+	const char *identity = env->GetStringUTFChars(deviceIdentity, NULL);
+	int inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	jlong expireTime = getMonotonicTime() + (timeout * 1000000ll), waitTime;
+	char devicePath[PATH_MAX], eventBuffer[4096];
+	bool deviceFound = false;
+
+	while (!deviceFound && (inotifyFD != -1))
+	{
+		// Check whether the device is present and accessible, only then waiting for the next change
+		watchDeviceDirectories(inotifyFD, identity);
+		if ((realpath(identity, devicePath) != NULL) && (access(devicePath, R_OK | W_OK) == 0))
+			deviceFound = true;
+		else if ((waitTime = expireTime - getMonotonicTime()) <= 0)
+			break;
+		else
+		{
+			struct pollfd waitingSet = { inotifyFD, POLLIN, 0 };
+			struct timespec waitTimeSpec = { (time_t)(waitTime / 1000000000ll), (long)(waitTime % 1000000000ll) };
+			if ((ppoll(&waitingSet, 1, &waitTimeSpec, NULL) == -1) && (errno != EINTR))
+				break;
+			while (read(inotifyFD, eventBuffer, sizeof(eventBuffer)) > 0);
+		}
+	}
+	if (inotifyFD != -1)
+		close(inotifyFD);
+	env->ReleaseStringUTFChars(deviceIdentity, identity);
+
+	// Return the current name of the device node if it reappeared
+	return deviceFound ? env->NewStringUTF(devicePath) : NULL;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createReceiveBufferPool(JNIEnv *env, jclass serialCommClass, jint numBuffers, jint bufferSize)
+{
+	ReceiveBufferPool *pool = (ReceiveBufferPool*)calloc(1, sizeof(ReceiveBufferPool));
+	if (pool == NULL)
+		return 0;
+
+	// Map the whole slab at once with its pages already faulted in, so the first reads into it do not stall
+	pool->numBuffers = numBuffers;
+	pool->bufferSize = bufferSize;
+	pool->bufferStride = (bufferSize + 63) & ~63;
+	pool->slabSize = (size_t)numBuffers * pool->bufferStride;
+	if ((pool->slab = (unsigned char*)mmap(NULL, pool->slabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0)) == MAP_FAILED)
+	{
+		free(pool);
+		return 0;
+	}
+	registerNativeBuffer(pool->slab, pool->slabSize);
+	return (jlong)pool;
+}
+
+JNIEXPORT jobject JNICALL Java_j_extensions_comm_SerialComm_getReceiveBuffer(JNIEnv *env, jclass serialCommClass, jlong poolState, jint index)
+{
+	ReceiveBufferPool *pool = (ReceiveBufferPool*)poolState;
+	return env->NewDirectByteBuffer(pool->slab + ((size_t)index * pool->bufferStride), pool->bufferSize);
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyReceiveBufferPool(JNIEnv *env, jclass serialCommClass, jlong poolState)
+{
+	ReceiveBufferPool *pool = (ReceiveBufferPool*)poolState;
+	unregisterNativeBuffer(pool->slab);
+	munmap(pool->slab, pool->slabSize);
+	free(pool);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readIntoPooledBuffer(JNIEnv *env, jobject obj, jobject bufferObj, jint timeout)
+{
+	// Get port handle from Java class
+	jlong traceStart = traceBegin();
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return (jint)traceCall(TRACE_READ_INTO_POOLED_BUFFER, portHandle, timeout, -1, traceStart);
+
+	// Get the native memory behind the pooled buffer
+	jclass bufferClass = env->GetObjectClass(bufferObj);
+	jobject data = env->GetObjectField(bufferObj, env->GetFieldID(bufferClass, "data", "Ljava/nio/ByteBuffer;"));
+	unsigned char *buffer = (unsigned char*)env->GetDirectBufferAddress(data);
+	int bufferSize = (int)env->GetDirectBufferCapacity(data), numBytesRead = 0, waitResult;
+	jlong expireTime = getMonotonicTime() + (timeout * 1000000ll), waitTime;
+
+	// Wait for data to arrive, blocking indefinitely if no timeout was specified, then read it straight into the buffer
+	do
+	{
+		waitTime = expireTime - getMonotonicTime();
+		if ((waitResult = waitForPort(port, POLLIN, (timeout == 0) ? -1 : (waitTime < 0) ? 0 : waitTime)) == 0)
+		{
+			numBytesRead = 0;
+			break;
+		}
+		else if ((waitResult == -1) || ((numBytesRead = read(port->portFD, buffer, bufferSize)) == 0) ||
+				((numBytesRead == -1) && (errno != EAGAIN) && (errno != EINTR)))
+		{
+			numBytesRead = -1;
+			break;
+		}
+	} while (numBytesRead <= 0);
+	if (numBytesRead > 0)
+		env->SetLongField(bufferObj, env->GetFieldID(bufferClass, "arrivalTime", "J"), getMonotonicTime());
+	env->DeleteLocalRef(data);
+	releasePortHandle(port);
+
+	// Problem reading, close port
+	if (numBytesRead == -1)
+		closeJavaPort(env, obj, portHandle);
+	return (jint)traceCall(TRACE_READ_INTO_POOLED_BUFFER, portHandle, timeout, (numBytesRead < 0) ? -1 : numBytesRead, traceStart);
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_setNativeTraceEnabled(JNIEnv *env, jclass serialCommClass, jboolean enabled)
+{
+	__atomic_store_n(&traceEnabled, enabled ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_dumpNativeTrace(JNIEnv *env, jclass serialCommClass, jstring fileName)
+{
+	// Create the trace file and write its header
+	const char *fileNameString = env->GetStringUTFChars(fileName, NULL);
+	FILE *traceFile = fopen(fileNameString, "wb");
+	env->ReleaseStringUTFChars(fileName, fileNameString);
+	TraceEvent *events = (TraceEvent*)malloc(TRACE_RING_SIZE * sizeof(TraceEvent));
+	unsigned int header[2] = { TRACE_FILE_VERSION, sizeof(TraceEvent) };
+	bool success = (traceFile != NULL) && (events != NULL) && (fwrite("SCTRACE", 8, 1, traceFile) == 1) && (fwrite(header, sizeof(header), 1, traceFile) == 1);
+
+	// Copy the most recent events out of every ring, skipping any that are being overwritten at the same time
+	for (TraceRing *ring = __atomic_load_n(&traceRings, __ATOMIC_ACQUIRE); success && (ring != NULL); ring = ring->next)
+	{
+		unsigned long long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		unsigned int threadInfo[2] = { (unsigned int)ring->threadId, 0 };
+		for (unsigned long long i = (head > TRACE_RING_SIZE) ? (head - TRACE_RING_SIZE) : 0; i < head; ++i)
+		{
+			TraceEvent *event = &ring->events[i & (TRACE_RING_SIZE - 1)];
+			unsigned int sequence = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+			events[threadInfo[1]] = *event;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if ((sequence == (unsigned int)(i + 1)) && (__atomic_load_n(&event->sequence, __ATOMIC_RELAXED) == sequence))
+				++threadInfo[1];
+		}
+		if (threadInfo[1] > 0)
+			success = (fwrite(threadInfo, sizeof(threadInfo), 1, traceFile) == 1) && (fwrite(events, sizeof(TraceEvent), threadInfo[1], traceFile) == threadInfo[1]);
+	}
+
+	free(events);
+	if ((traceFile != NULL) && (fclose(traceFile) != 0))
+		success = false;
+	return success ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_openPortsInParallel(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jlongArray openTimes, jint maxThreads)
+{
+	// Get relevant SerialComm methods and IDs
+	jfieldID comPortID = env->GetFieldID(serialCommClass, "comPort", "Ljava/lang/String;");
+	jfieldID portHandleID = env->GetFieldID(serialCommClass, "portHandle", "J");
+	jfieldID isOpenedID = env->GetFieldID(serialCommClass, "isOpened", "Z");
+	jfieldID rs485EmulatedID = env->GetFieldID(serialCommClass, "rs485Emulated", "Z");
+	jfieldID deviceIdentityID = env->GetFieldID(serialCommClass, "deviceIdentity", "Ljava/lang/String;");
+	jfieldID autoReconnectID = env->GetFieldID(serialCommClass, "autoReconnect", "Z");
+	jmethodID startMonitorID = env->GetMethodID(serialCommClass, "startConnectionMonitor", "()V");
+	int numPorts = env->GetArrayLength(ports), numOpened;
+	SerialPortOpenRequest *requests = (SerialPortOpenRequest*)calloc((numPorts > 0) ? numPorts : 1, sizeof(SerialPortOpenRequest));
+	jlong *portOpenTimes = (jlong*)calloc((numPorts > 0) ? numPorts : 1, sizeof(jlong));
+	if ((requests == NULL) || (portOpenTimes == NULL))
+	{
+		free(requests);
+		free(portOpenTimes);
+		return 0;
+	}
+
+	// Copy the name and settings of every port, since the worker threads cannot access the Java objects
+	for (int i = 0; i < numPorts; ++i)
+	{
+		jobject port = env->GetObjectArrayElement(ports, i);
+		requests[i].portHandle = -1l;
+		if (port == NULL)
+			continue;
+		jstring portNameJString = (jstring)env->GetObjectField(port, comPortID);
+		const char *portName = env->GetStringUTFChars(portNameJString, NULL);
+		requests[i].portName = strdup(portName);
+		env->ReleaseStringUTFChars(portNameJString, portName);
+		getPortConfig(env, port, &requests[i].config);
+		env->DeleteLocalRef(portNameJString);
+		env->DeleteLocalRef(port);
+	}
+
+	// Open and configure all ports at once
+	numOpened = openSerialPorts(requests, numPorts, maxThreads);
+
+	// Update the Java objects with the results
+	for (int i = 0; i < numPorts; ++i)
+	{
+		jobject port = env->GetObjectArrayElement(ports, i);
+		portOpenTimes[i] = requests[i].openTime;
+		free((void*)requests[i].portName);
+		if (port == NULL)
+			continue;
+		env->SetBooleanField(port, rs485EmulatedID, requests[i].config.rs485Emulated ? JNI_TRUE : JNI_FALSE);
+		env->SetLongField(port, portHandleID, requests[i].portHandle);
+		env->SetBooleanField(port, isOpenedID, (requests[i].portHandle == -1l) ? JNI_FALSE : JNI_TRUE);
+		if (requests[i].portHandle != -1l)
+		{
+			jstring deviceIdentity = env->NewStringUTF(requests[i].deviceIdentity);
+			env->SetObjectField(port, deviceIdentityID, deviceIdentity);
+			env->DeleteLocalRef(deviceIdentity);
+			if (env->GetBooleanField(port, autoReconnectID))
+				env->CallVoidMethod(port, startMonitorID);
+		}
+		env->DeleteLocalRef(port);
+	}
+	env->SetLongArrayRegion(openTimes, 0, numPorts, portOpenTimes);
+	free(portOpenTimes);
+	free(requests);
+	return numOpened;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_getModemLines(JNIEnv *env, jobject obj)
+{
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return -1;
+	int lineStates = getModemLines(port);
+	releasePortHandle(port);
+	return lineStates;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_setModemLine(JNIEnv *env, jobject obj, jint line, jboolean asserted)
+{
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	if (port == NULL)
+		return JNI_FALSE;
+	bool success = setModemLines(port, line, asserted);
+	releasePortHandle(port);
+	return success ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createModemLineMonitor(JNIEnv *env, jobject obj, jint lineMask)
+{
+	jlong portHandle = env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
+	return (jlong)startModemLineMonitor(portHandle, lineMask);
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_stopModemLineMonitor(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+	stopModemLineMonitor((ModemLineMonitor*)monitorState);
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyModemLineMonitor(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+	destroyModemLineMonitor((ModemLineMonitor*)monitorState);
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readModemLineEvents(JNIEnv *env, jclass serialCommClass, jlong monitorState, jlongArray timestamps, jintArray lineStates, jintArray changedLines, jint timeout)
+{
+	// Wait for a batch of events, which is limited by the size of the Java arrays
+	ModemLineEvent events[256];
+	jlong eventTimestamps[256];
+	jint eventLineStates[256], eventChangedLines[256];
+	int maxEvents = env->GetArrayLength(timestamps);
+	int numEvents = readModemLineEvents((ModemLineMonitor*)monitorState, events, (maxEvents < 256) ? maxEvents : 256, (timeout == 0) ? -1 : (timeout * 1000000ll));
+
+	// Return the events in parallel Java arrays
+	for (int i = 0; i < numEvents; ++i)
+	{
+		eventTimestamps[i] = events[i].timestamp;
+		eventLineStates[i] = events[i].lineStates;
+		eventChangedLines[i] = events[i].changedLines;
+	}
+	if (numEvents > 0)
+	{
+		env->SetLongArrayRegion(timestamps, 0, numEvents, eventTimestamps);
+		env->SetIntArrayRegion(lineStates, 0, numEvents, eventLineStates);
+		env->SetIntArrayRegion(changedLines, 0, numEvents, eventChangedLines);
+	}
+	return numEvents;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_getNumDroppedModemLineEvents(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+	return (jlong)getNumDroppedModemLineEvents((ModemLineMonitor*)monitorState);
 }
 
 #endif
@@ -0,0 +1,1112 @@
+/*
+ * SerialPort.cpp
+ *
+ *       Created on:  Feb 25, 2012
+ *  Last Updated on:  Mar 14, 2013
+ *           Author:  Will Hedgecock
+ *
+ * Copyright (C) 2012-2013 Will Hedgecock
+ *
+ * This file is part of SerialComm.
+ *
+ * SerialComm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SerialComm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SerialComm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef __linux__
+#ifndef CMSPAR
+#define CMSPAR 010000000000
+#endif
+#ifndef TIOCGRS485
+#define TIOCGRS485 0x542E
+#endif
+#ifndef TIOCSRS485
+#define TIOCSRS485 0x542F
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <cerrno>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <pthread.h>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <climits>
+#include <time.h>
+#include "SerialPort.h"
+
+// Native port handles live in a fixed table and are never freed, so a stale handle can always be validated safely.
+// Each slot's state packs a generation counter (upper 32 bits) with flags and a reference count (lower 32 bits), and
+// the port descriptor is only closed once the last native call using it has released its reference.
+#define MAX_PORT_HANDLES			1024
+#define PORT_HANDLE_IN_USE			0x80000000ull
+#define PORT_HANDLE_CLOSING			0x40000000ull
+#define PORT_HANDLE_REFCOUNT_MASK	0x3FFFFFFFull
+#define MODEM_WAIT_IDLE				0
+#define MODEM_WAIT_STARTING			1
+#define MODEM_WAIT_ACTIVE			2
+#define MODEM_WAIT_SIGNALLING		3
+#define MODEM_WAIT_PREFERRED_SIGNAL	(SIGRTMAX - 3)
+#define MODEM_EVENT_RING_SIZE		256
+static SerialPortHandle portHandles[MAX_PORT_HANDLES];
+static int modemWaitSignal = -1;
+
+// Creates a handle for a newly opened port, holding one reference on behalf of its owner
+int64_t createPortHandle(int portFD)
+{
+	int eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	for (int i = 0; (eventFD != -1) && (timerFD != -1) && (i < MAX_PORT_HANDLES); ++i)
+	{
+		unsigned long long state = __atomic_load_n(&portHandles[i].state, __ATOMIC_ACQUIRE);
+		if (((state & PORT_HANDLE_IN_USE) == 0) && __atomic_compare_exchange_n(&portHandles[i].state, &state,
+				state | PORT_HANDLE_IN_USE | 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		{
+			portHandles[i].portFD = portFD;
+			portHandles[i].eventFD = eventFD;
+			portHandles[i].timerFD = timerFD;
+			portHandles[i].lastTransmitEnd = 0;
+			return (int64_t)((state >> 32) << 32) | i;
+		}
+	}
+	if (eventFD != -1)
+		close(eventFD);
+	if (timerFD != -1)
+		close(timerFD);
+	return -1l;
+}
+
+// Takes a reference to the port referred to by a handle, returning NULL if it is stale or being closed
+SerialPortHandle* acquirePortHandle(int64_t handle)
+{
+	unsigned long long slot = (unsigned long long)handle & 0xFFFFFFFFull, generation = ((unsigned long long)handle >> 32);
+	if ((handle == -1l) || (slot >= MAX_PORT_HANDLES))
+		return NULL;
+
+	SerialPortHandle *port = &portHandles[slot];
+	unsigned long long state = __atomic_load_n(&port->state, __ATOMIC_ACQUIRE);
+	do
+	{
+		if (((state >> 32) != generation) || ((state & PORT_HANDLE_IN_USE) == 0) || (state & PORT_HANDLE_CLOSING))
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&port->state, &state, state + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return port;
+}
+
+// Drops a reference to a port, closing its descriptor and recycling the handle if it was the last one
+void releasePortHandle(SerialPortHandle *port)
+{
+	unsigned long long state = __atomic_sub_fetch(&port->state, 1, __ATOMIC_ACQ_REL);
+	if (((state & PORT_HANDLE_REFCOUNT_MASK) == 0) && (state & PORT_HANDLE_CLOSING))
+	{
+		close(port->portFD);
+		close(port->eventFD);
+		close(port->timerFD);
+		__atomic_store_n(&port->state, ((state >> 32) + 1) << 32, __ATOMIC_RELEASE);
+	}
+}
+
+// Wakes up a modem line monitor thread blocked in TIOCMIWAIT, which cannot be interrupted any other way
+static void interruptModemWait(SerialPortHandle *port)
+{
+	int waitState = MODEM_WAIT_ACTIVE;
+	if (__atomic_compare_exchange_n(&port->modemWaitState, &waitState, MODEM_WAIT_SIGNALLING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		pthread_kill(port->modemWaitThread, modemWaitSignal);
+		__atomic_store_n(&port->modemWaitState, MODEM_WAIT_ACTIVE, __ATOMIC_RELEASE);
+	}
+}
+
+// Starts closing a port: new calls are refused, blocked calls are woken up, and the owner's reference is dropped
+bool closePortHandle(int64_t handle)
+{
+	unsigned long long slot = (unsigned long long)handle & 0xFFFFFFFFull, generation = ((unsigned long long)handle >> 32);
+	if ((handle == -1l) || (slot >= MAX_PORT_HANDLES))
+		return false;
+
+	SerialPortHandle *port = &portHandles[slot];
+	unsigned long long state = __atomic_load_n(&port->state, __ATOMIC_ACQUIRE);
+	do
+	{
+		if (((state >> 32) != generation) || ((state & PORT_HANDLE_IN_USE) == 0) || (state & PORT_HANDLE_CLOSING))
+			return false;
+	} while (!__atomic_compare_exchange_n(&port->state, &state, state | PORT_HANDLE_CLOSING, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	// A signal that arrives just before the monitor thread enters TIOCMIWAIT is lost, so keep signalling until it has let go of the port
+	eventfd_write(port->eventFD, 1);
+	while (__atomic_load_n(&port->modemWaitState, __ATOMIC_ACQUIRE) != MODEM_WAIT_IDLE)
+	{
+		interruptModemWait(port);
+		preciseSleep(1000);
+	}
+	releasePortHandle(port);
+	return true;
+}
+
+// Locks the shared port table into memory so that real-time threads never take page faults on it
+bool lockPortHandles(void)
+{
+	return (mlock(portHandles, sizeof(portHandles)) == 0);
+}
+
+// Waits until the port is ready for the requested events, returning 1 if ready, 0 on timeout, or -1 if the port failed or is closing
+int waitForPort(SerialPortHandle *port, short events, int64_t timeoutNanos)
+{
+	struct pollfd waitingSet[2] = { { port->portFD, events, 0 }, { port->eventFD, POLLIN, 0 } };
+	struct timespec waitTime = { (time_t)(timeoutNanos / 1000000000ll), (long)(timeoutNanos % 1000000000ll) };
+	int pollResult;
+
+	while (((pollResult = ppoll(waitingSet, 2, (timeoutNanos < 0) ? NULL : &waitTime, NULL)) == -1) && (errno == EINTR));
+	if (pollResult == 0)
+		return 0;
+	else if ((pollResult == -1) || waitingSet[1].revents || ((waitingSet[0].revents & events) == 0))
+		return -1;
+	return 1;
+}
+
+// Returns the current monotonic system time in nanoseconds
+int64_t getMonotonicTime(void)
+{
+	struct timespec currTime;
+	clock_gettime(CLOCK_MONOTONIC, &currTime);
+	return ((int64_t)currTime.tv_sec * 1000000000ll) + currTime.tv_nsec;
+}
+
+// Sleeps until the specified monotonic system time in nanoseconds
+void sleepUntil(int64_t wakeTime)
+{
+	struct timespec sleepTime = { (time_t)(wakeTime / 1000000000ll), (long)(wakeTime % 1000000000ll) };
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sleepTime, NULL) == EINTR);
+}
+
+// Sleeps for the specified number of microseconds using the monotonic clock
+void preciseSleep(long microseconds)
+{
+	struct timespec sleepTime = { microseconds / 1000000, (microseconds % 1000000) * 1000 };
+	while ((microseconds > 0) && (clock_nanosleep(CLOCK_MONOTONIC, 0, &sleepTime, &sleepTime) == EINTR));
+}
+
+// Waits until all queued output, including the contents of the UART shift register, has been physically transmitted, returning -1
+// if the port is closed in the meantime (unlike tcdrain(), which cannot be interrupted while flow control holds up the output)
+int drainOutput(SerialPortHandle *port, int64_t charTime)
+{
+	int bytesWaiting = 0;
+	unsigned int lineStatus = 0;
+
+	// Sleep for roughly the time it takes to transmit whatever is left in the output queue
+	while ((ioctl(port->portFD, TIOCOUTQ, &bytesWaiting) == 0) && (bytesWaiting > 0))
+		if (waitForPort(port, 0, bytesWaiting * charTime) == -1)
+			return -1;
+
+	// Then check once per character time whether the UART has shifted out its last stop bit
+	while ((ioctl(port->portFD, TIOCSERGETLSR, &lineStatus) == 0) && ((lineStatus & TIOCSER_TEMT) == 0))
+		if (waitForPort(port, 0, charTime) == -1)
+			return -1;
+	return 0;
+}
+
+// Asserts or de-asserts the RTS modem control line
+void setRtsLine(int portFD, bool asserted)
+{
+	int modemBits = TIOCM_RTS;
+	ioctl(portFD, asserted ? TIOCMBIS : TIOCMBIC, &modemBits);
+}
+
+// Returns the time it takes to transmit one character at the configured port settings, in nanoseconds
+int64_t getCharacterTime(const SerialPortConfig *config)
+{
+	double bitsPerChar = 2.0 + config->dataBits + ((config->parity == SERIAL_NO_PARITY) ? 0.0 : 1.0) +
+			((config->stopBits == SERIAL_TWO_STOP_BITS) ? 1.0 : (config->stopBits == SERIAL_ONE_POINT_FIVE_STOP_BITS) ? 0.5 : 0.0);
+	return (int64_t)((bitsPerChar * 1000000000.0) / ((config->baudRate > 0) ? config->baudRate : 9600));
+}
+
+// Sleeps until the specified monotonic system time using the port's timer, returning -1 if the port is closed in the meantime
+static int waitForPortTime(SerialPortHandle *port, int64_t wakeTime)
+{
+	struct itimerspec timerSetting = { { 0, 0 }, { (time_t)(wakeTime / 1000000000ll), (long)(wakeTime % 1000000000ll) } };
+	struct pollfd waitingSet[2] = { { port->timerFD, POLLIN, 0 }, { port->eventFD, POLLIN, 0 } };
+	unsigned long long numExpirations;
+	int pollResult;
+
+	if (wakeTime <= getMonotonicTime())
+		return 0;
+	timerfd_settime(port->timerFD, TFD_TIMER_ABSTIME, &timerSetting, NULL);
+	while (((pollResult = ppoll(waitingSet, 2, NULL, NULL)) == -1) && (errno == EINTR));
+	if ((pollResult == -1) || waitingSet[1].revents)
+		return -1;
+	while ((read(port->timerFD, &numExpirations, sizeof(numExpirations)) == -1) && (errno == EINTR));
+	return 0;
+}
+
+// Accumulates one achieved transmit gap into the pacing statistics
+static void recordPacingGap(int64_t *statistics, int baseIndex, int64_t achievedGap)
+{
+	if ((statistics[baseIndex] == 0) || (achievedGap < statistics[baseIndex + 2]))
+		statistics[baseIndex + 2] = achievedGap;
+	if ((statistics[baseIndex] == 0) || (achievedGap > statistics[baseIndex + 3]))
+		statistics[baseIndex + 3] = achievedGap;
+	statistics[baseIndex + 1] += achievedGap;
+	++statistics[baseIndex];
+}
+
+// Writes data one character at a time, enforcing the configured gaps between characters and before the start of the frame
+static int writePacedCharacters(SerialPortHandle *port, const SerialPortConfig *config, const unsigned char *buffer, int bytesToWrite,
+		int64_t interByteGap, int64_t interFrameGap, int64_t *statistics)
+{
+	int64_t charTime = getCharacterTime(config), lastWriteTime = 0, writeTime, wakeTime;
+	int numBytesWritten = 0, writeResult;
+
+	while (numBytesWritten < bytesToWrite)
+	{
+		// Wait until the previous frame or character has been followed by the required amount of idle line time
+		if (numBytesWritten == 0)
+			wakeTime = (port->lastTransmitEnd == 0) ? 0 : (port->lastTransmitEnd + interFrameGap);
+		else
+			wakeTime = (interByteGap > 0) ? (lastWriteTime + charTime + interByteGap) : 0;
+		if (waitForPortTime(port, wakeTime) == -1)
+			return -1;
+
+		// Hand the next character, or the rest of the frame if there are no inter-byte gaps, to the driver
+		if ((writeResult = write(port->portFD, buffer + numBytesWritten, (interByteGap > 0) ? 1 : (bytesToWrite - numBytesWritten))) <= 0)
+		{
+			if (((writeResult == -1) && (errno != EAGAIN) && (errno != EINTR)) || (waitForPort(port, POLLOUT, -1) == -1))
+				return -1;
+			continue;
+		}
+		writeTime = getMonotonicTime();
+
+		// Record the achieved gaps, measured from the estimated end of the previous character
+		if ((numBytesWritten == 0) && (port->lastTransmitEnd != 0) && (interFrameGap > 0))
+			recordPacingGap(statistics, PACING_FRAME_GAP_COUNT, writeTime - port->lastTransmitEnd);
+		else if ((numBytesWritten > 0) && (interByteGap > 0))
+			recordPacingGap(statistics, PACING_BYTE_GAP_COUNT, writeTime - lastWriteTime - charTime);
+		lastWriteTime = writeTime;
+		numBytesWritten += writeResult;
+	}
+
+	// The inter-frame gap starts once the last stop bit has physically left the port
+	if ((interFrameGap > 0) && (drainOutput(port, charTime) == -1))
+		return -1;
+	port->lastTransmitEnd = (interFrameGap > 0) ? getMonotonicTime() : (lastWriteTime + charTime);
+	statistics[PACING_BYTE_GAP_REQUESTED] = interByteGap;
+	statistics[PACING_FRAME_GAP_REQUESTED] = interFrameGap;
+	return numBytesWritten;
+}
+
+// Writes a paced frame with the calling thread's timer slack removed, so that short gaps are not stretched by the kernel
+static int writePacedToPort(SerialPortHandle *port, const SerialPortConfig *config, const unsigned char *buffer, int bytesToWrite,
+		int64_t interByteGap, int64_t interFrameGap, int64_t *statistics)
+{
+	int originalTimerSlack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+	prctl(PR_SET_TIMERSLACK, 1, 0, 0, 0);
+	int numBytesWritten = writePacedCharacters(port, config, buffer, bytesToWrite, interByteGap, interFrameGap, statistics);
+	if (originalTimerSlack > 0)
+		prctl(PR_SET_TIMERSLACK, originalTimerSlack, 0, 0, 0);
+	return numBytesWritten;
+}
+
+// Returns whether paced writes are enabled, calculating the configured gaps in nanoseconds
+bool getPacingGaps(const SerialPortConfig *config, int64_t *interByteGap, int64_t *interFrameGap)
+{
+	if ((config->pacingInterByteGap <= 0.0) && (config->pacingInterFrameGap <= 0.0))
+		return false;
+	double unitTime = (config->pacingUnits == SERIAL_PACING_CHARACTER_TIMES) ? (double)getCharacterTime(config) : 1000.0;
+	*interByteGap = (config->pacingInterByteGap > 0.0) ? (int64_t)(config->pacingInterByteGap * unitTime) : 0;
+	*interFrameGap = (config->pacingInterFrameGap > 0.0) ? (int64_t)(config->pacingInterFrameGap * unitTime) : 0;
+	return true;
+}
+
+// Returns the number of bytes waiting to be read from the port
+int getBytesAvailable(SerialPortHandle *port)
+{
+	int numBytesAvailable = -1;
+	ioctl(port->portFD, FIONREAD, &numBytesAvailable);
+	return numBytesAvailable;
+}
+
+// Reads from the port according to the timeout mode, returning the number of bytes read or -1 if the port failed or was closed
+int readFromPort(SerialPortHandle *port, void *buffer, int bytesToRead, int timeoutMode, int readTimeout)
+{
+	int numBytesRead = 0, bytesRemaining = bytesToRead, index = 0, waitResult;
+	int64_t expireTime = getMonotonicTime() + (readTimeout * 1000000ll);
+
+	// Full-blocking mode keeps reading until all bytes have arrived, the semi-blocking and non-blocking modes return as soon as any data is available
+	bool readFully = (timeoutMode == SERIAL_TIMEOUT_READ_BLOCKING);
+	bool waitForever = (readTimeout == 0) && (timeoutMode != SERIAL_TIMEOUT_NONBLOCKING);
+
+	// A readable port that returns no data has hung up, so a read of nothing must not reach read() and be mistaken for one
+	if (bytesToRead <= 0)
+		return 0;
+	do
+	{
+		// Wait for data to arrive without holding up a concurrent writer or a closing thread
+		int64_t waitTime = (timeoutMode == SERIAL_TIMEOUT_NONBLOCKING) ? 0 : (expireTime - getMonotonicTime());
+		if ((waitResult = waitForPort(port, POLLIN, waitForever ? -1 : (waitTime < 0) ? 0 : waitTime)) == 0)
+			break;
+		else if ((waitResult == -1) || ((numBytesRead = read(port->portFD, (char*)buffer + index, bytesRemaining)) == 0) ||
+				((numBytesRead == -1) && (errno != EAGAIN) && (errno != EINTR)))
+			return -1;
+
+		// Fix index variables
+		if (numBytesRead > 0)
+		{
+			index += numBytesRead;
+			bytesRemaining -= numBytesRead;
+		}
+	} while (readFully && (bytesRemaining > 0));
+	return index;
+}
+
+// Sleeps in the kernel until some data arrives, independent of any timeout, returning the number of bytes read or -1 if the port failed or was closed
+int readAvailableFromPort(SerialPortHandle *port, void *buffer, int bytesToRead)
+{
+	int numBytesRead;
+	if (bytesToRead <= 0)
+		return 0;
+	while (waitForPort(port, POLLIN, -1) == 1)
+	{
+		if ((numBytesRead = read(port->portFD, buffer, bytesToRead)) > 0)
+			return numBytesRead;
+		else if ((numBytesRead == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+			break;
+	}
+	return -1;
+}
+
+// Writes all data to the port, pacing it and manually controlling the RS-485 transmitter as configured; the gaps achieved by
+// a paced write are stored in pacingStatistics, which must hold PACING_NUM_STATISTICS zeroed values if it is not NULL
+int writeToPort(SerialPortHandle *port, const SerialPortConfig *config, const void *buffer, int bytesToWrite, int64_t *pacingStatistics)
+{
+	int64_t interByteGap, interFrameGap, statistics[PACING_NUM_STATISTICS] = { 0 };
+	int numBytesWritten = 0, writeResult;
+
+	// Enable the RS-485 transmitter
+	if (config->rs485Emulated)
+	{
+		setRtsLine(port->portFD, config->rs485RtsActiveHigh);
+		preciseSleep(config->rs485DelayBefore);
+	}
+
+	// Write to port, either paced or waiting for room in the output queue whenever it is full
+	if (getPacingGaps(config, &interByteGap, &interFrameGap))
+		numBytesWritten = writePacedToPort(port, config, (const unsigned char*)buffer, bytesToWrite, interByteGap, interFrameGap,
+				pacingStatistics ? pacingStatistics : statistics);
+	else while (numBytesWritten < bytesToWrite)
+	{
+		if ((writeResult = write(port->portFD, (const char*)buffer + numBytesWritten, bytesToWrite - numBytesWritten)) > 0)
+			numBytesWritten += writeResult;
+		else if (((writeResult == -1) && (errno != EAGAIN) && (errno != EINTR)) || (waitForPort(port, POLLOUT, -1) == -1))
+		{
+			numBytesWritten = -1;
+			break;
+		}
+	}
+
+	// Release the RS-485 transmitter as soon as the last stop bit has left the port
+	if (config->rs485Emulated && (numBytesWritten != -1))
+	{
+		if (drainOutput(port, getCharacterTime(config)) == -1)
+			numBytesWritten = -1;
+		else
+			preciseSleep(config->rs485DelayAfter);
+		setRtsLine(port->portFD, !config->rs485RtsActiveHigh);
+		if (!config->rs485RxDuringTx)
+			tcflush(port->portFD, TCIFLUSH);
+	}
+	return numBytesWritten;
+}
+
+// Returns the states of the modem control lines, or -1 if they cannot be read
+int getModemLines(SerialPortHandle *port)
+{
+	int modemBits;
+	if (ioctl(port->portFD, TIOCMGET, &modemBits) != 0)
+		return -1;
+	return ((modemBits & TIOCM_CTS) ? SERIAL_LINE_CTS : 0) | ((modemBits & TIOCM_DSR) ? SERIAL_LINE_DSR : 0) | ((modemBits & TIOCM_CD) ? SERIAL_LINE_DCD : 0) |
+			((modemBits & TIOCM_RI) ? SERIAL_LINE_RI : 0) | ((modemBits & TIOCM_DTR) ? SERIAL_LINE_DTR : 0) | ((modemBits & TIOCM_RTS) ? SERIAL_LINE_RTS : 0);
+}
+
+// Asserts or de-asserts the DTR and/or RTS output lines
+bool setModemLines(SerialPortHandle *port, int lines, bool asserted)
+{
+	int modemBits = ((lines & SERIAL_LINE_DTR) ? TIOCM_DTR : 0) | ((lines & SERIAL_LINE_RTS) ? TIOCM_RTS : 0);
+	return (modemBits != 0) && (ioctl(port->portFD, asserted ? TIOCMBIS : TIOCMBIC, &modemBits) == 0);
+}
+
+// Modem line changes recorded by a monitor thread and read by another thread, using a single-producer single-consumer ring
+struct ModemLineMonitor
+{
+	SerialPortHandle *port;
+	pthread_t thread;
+	int lineMask, eventFD, stopping, stopped;
+	unsigned int head, tail;
+	unsigned long long numDropped;
+	ModemLineEvent events[MODEM_EVENT_RING_SIZE];
+};
+static pthread_once_t modemWaitSignalOnce = PTHREAD_ONCE_INIT;
+
+// Does nothing, since the modem wait signal only exists to make TIOCMIWAIT return early
+static void handleModemWaitSignal(int) {}
+
+// Installs the modem wait signal handler without SA_RESTART, so that the signal interrupts TIOCMIWAIT instead of restarting it,
+// on the first real-time signal at or below the preferred one that the application has not claimed for itself
+static void installModemWaitSignal(void)
+{
+	struct sigaction signalAction, existingAction;
+	memset(&signalAction, 0, sizeof(signalAction));
+	signalAction.sa_handler = handleModemWaitSignal;
+	sigemptyset(&signalAction.sa_mask);
+	for (int signalNumber = MODEM_WAIT_PREFERRED_SIGNAL; signalNumber >= SIGRTMIN; --signalNumber)
+		if ((sigaction(signalNumber, NULL, &existingAction) == 0) && !(existingAction.sa_flags & SA_SIGINFO) &&
+				(existingAction.sa_handler == SIG_DFL) && (sigaction(signalNumber, &signalAction, NULL) == 0))
+		{
+			modemWaitSignal = signalNumber;
+			return;
+		}
+}
+
+// Records modem line changes until the monitor is stopped, the port is closed, or the device hangs up
+static void* monitorModemLines(void *monitorPointer)
+{
+	ModemLineMonitor *monitor = (ModemLineMonitor*)monitorPointer;
+	SerialPortHandle *port = monitor->port;
+	struct serial_icounter_struct lastCounts, counts;
+	int waitMask = ((monitor->lineMask & SERIAL_LINE_CTS) ? TIOCM_CTS : 0) | ((monitor->lineMask & SERIAL_LINE_DSR) ? TIOCM_DSR : 0) |
+			((monitor->lineMask & SERIAL_LINE_DCD) ? TIOCM_CD : 0) | ((monitor->lineMask & SERIAL_LINE_RI) ? TIOCM_RI : 0);
+	int lastStates = getModemLines(port), states, changedLines, waitResult;
+	bool haveCounts = (ioctl(port->portFD, TIOCGICOUNT, &lastCounts) == 0);
+	int64_t timestamp;
+
+	// Only the wakeup signal may be delivered to this thread
+	sigset_t wakeupSignal;
+	sigemptyset(&wakeupSignal);
+	sigaddset(&wakeupSignal, modemWaitSignal);
+	pthread_sigmask(SIG_UNBLOCK, &wakeupSignal, NULL);
+	port->modemWaitThread = pthread_self();
+	__atomic_store_n(&port->modemWaitState, MODEM_WAIT_ACTIVE, __ATOMIC_RELEASE);
+
+	// A stop or close that signals us between this check and entering TIOCMIWAIT keeps signalling until we have stopped
+	while (!__atomic_load_n(&monitor->stopping, __ATOMIC_ACQUIRE) && ((__atomic_load_n(&port->state, __ATOMIC_ACQUIRE) & PORT_HANDLE_CLOSING) == 0))
+	{
+		waitResult = ioctl(port->portFD, TIOCMIWAIT, waitMask);
+		timestamp = getMonotonicTime();
+		if ((waitResult == -1) && (errno == EINTR))
+			continue;
+		else if ((waitResult == -1) || ((states = getModemLines(port)) == -1))
+			break;
+
+		// Use the driver's transition counters to also catch pulses that ended before the line states could be read
+		changedLines = (states ^ lastStates);
+		if (haveCounts && (ioctl(port->portFD, TIOCGICOUNT, &counts) == 0))
+		{
+			changedLines |= ((counts.cts != lastCounts.cts) ? SERIAL_LINE_CTS : 0) | ((counts.dsr != lastCounts.dsr) ? SERIAL_LINE_DSR : 0) |
+					((counts.dcd != lastCounts.dcd) ? SERIAL_LINE_DCD : 0) | ((counts.rng != lastCounts.rng) ? SERIAL_LINE_RI : 0);
+			lastCounts = counts;
+		}
+		lastStates = states;
+		if ((changedLines &= monitor->lineMask) == 0)
+			continue;
+
+		// Queue the event and wake up the reader, dropping the event if the reader has fallen too far behind
+		unsigned int head = monitor->head;
+		if ((head - __atomic_load_n(&monitor->tail, __ATOMIC_ACQUIRE)) < MODEM_EVENT_RING_SIZE)
+		{
+			ModemLineEvent *event = &monitor->events[head % MODEM_EVENT_RING_SIZE];
+			event->timestamp = timestamp;
+			event->lineStates = states;
+			event->changedLines = changedLines;
+			__atomic_store_n(&monitor->head, head + 1, __ATOMIC_RELEASE);
+			eventfd_write(monitor->eventFD, 1);
+		}
+		else
+			__atomic_add_fetch(&monitor->numDropped, 1, __ATOMIC_RELAXED);
+	}
+
+	// Make sure no thread is about to signal us before giving up the port
+	int waitState = MODEM_WAIT_ACTIVE;
+	while (!__atomic_compare_exchange_n(&port->modemWaitState, &waitState, MODEM_WAIT_IDLE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		waitState = MODEM_WAIT_ACTIVE;
+		sched_yield();
+	}
+	__atomic_store_n(&monitor->stopped, 1, __ATOMIC_RELEASE);
+	eventfd_write(monitor->eventFD, 1);
+	releasePortHandle(port);
+	return NULL;
+}
+
+// Starts a thread recording changes of the selected modem status lines, returning NULL if the port is closed or already being monitored
+ModemLineMonitor* startModemLineMonitor(int64_t portHandle, int lineMask)
+{
+	SerialPortHandle *port = acquirePortHandle(portHandle);
+	ModemLineMonitor *monitor = (ModemLineMonitor*)calloc(1, sizeof(ModemLineMonitor));
+	int waitState = MODEM_WAIT_IDLE;
+	sigset_t allSignals, previousSignals;
+
+	// Claim the port's single modem wait slot, failing if every real-time signal that could wake the thread is in use
+	pthread_once(&modemWaitSignalOnce, installModemWaitSignal);
+	if ((modemWaitSignal == -1) || (port == NULL) || (monitor == NULL) || (getModemLines(port) == -1) || ((monitor->eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) ||
+			!__atomic_compare_exchange_n(&port->modemWaitState, &waitState, MODEM_WAIT_STARTING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		if (port != NULL)
+			releasePortHandle(port);
+		if ((monitor != NULL) && (monitor->eventFD > 0))
+			close(monitor->eventFD);
+		free(monitor);
+		return NULL;
+	}
+	monitor->port = port;
+	monitor->lineMask = lineMask & (SERIAL_LINE_CTS | SERIAL_LINE_DSR | SERIAL_LINE_DCD | SERIAL_LINE_RI);
+
+	// Start the thread with every signal blocked, so that it never receives signals meant for the rest of the process
+	sigfillset(&allSignals);
+	pthread_sigmask(SIG_BLOCK, &allSignals, &previousSignals);
+	int createResult = pthread_create(&monitor->thread, NULL, monitorModemLines, monitor);
+	pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+	if (createResult != 0)
+	{
+		__atomic_store_n(&port->modemWaitState, MODEM_WAIT_IDLE, __ATOMIC_RELEASE);
+		releasePortHandle(port);
+		close(monitor->eventFD);
+		free(monitor);
+		return NULL;
+	}
+	return monitor;
+}
+
+// Stops a modem line monitor, waiting until its thread has released the port
+void stopModemLineMonitor(ModemLineMonitor *monitor)
+{
+	// Keep signalling the thread, since a signal arriving just before it enters TIOCMIWAIT is lost
+	__atomic_store_n(&monitor->stopping, 1, __ATOMIC_RELEASE);
+	while (!__atomic_load_n(&monitor->stopped, __ATOMIC_ACQUIRE))
+	{
+		interruptModemWait(monitor->port);
+		preciseSleep(1000);
+	}
+}
+
+// Stops a modem line monitor and frees it
+void destroyModemLineMonitor(ModemLineMonitor *monitor)
+{
+	stopModemLineMonitor(monitor);
+	pthread_join(monitor->thread, NULL);
+	close(monitor->eventFD);
+	free(monitor);
+}
+
+// Waits for modem line events, returning the number of events read, 0 on timeout, or -1 once the monitor has stopped and every event has been read
+int readModemLineEvents(ModemLineMonitor *monitor, ModemLineEvent *events, int maxEvents, int64_t timeoutNanos)
+{
+	struct pollfd waitingSet = { monitor->eventFD, POLLIN, 0 };
+	int64_t expireTime = getMonotonicTime() + timeoutNanos, waitTime;
+	eventfd_t numWakeups;
+
+	while (true)
+	{
+		// Check whether the monitor has stopped before looking for events, since it queues its last event before stopping
+		bool stopped = __atomic_load_n(&monitor->stopped, __ATOMIC_ACQUIRE);
+		unsigned int head = __atomic_load_n(&monitor->head, __ATOMIC_ACQUIRE), tail = monitor->tail;
+		if (head != tail)
+		{
+			int numEvents = 0;
+			for ( ; (tail != head) && (numEvents < maxEvents); ++tail, ++numEvents)
+				events[numEvents] = monitor->events[tail % MODEM_EVENT_RING_SIZE];
+			__atomic_store_n(&monitor->tail, tail, __ATOMIC_RELEASE);
+			return numEvents;
+		}
+		else if (stopped)
+			return -1;
+
+		// Sleep until the monitor queues another event or the timeout expires
+		waitTime = expireTime - getMonotonicTime();
+		if ((timeoutNanos >= 0) && (waitTime <= 0))
+			return 0;
+		struct timespec waitTimeSpec = { (time_t)(waitTime / 1000000000ll), (long)(waitTime % 1000000000ll) };
+		if ((ppoll(&waitingSet, 1, (timeoutNanos < 0) ? NULL : &waitTimeSpec, NULL) == -1) && (errno != EINTR))
+			return -1;
+		eventfd_read(monitor->eventFD, &numWakeups);
+	}
+}
+
+// Returns the number of modem line events that were dropped because the reader had fallen too far behind
+unsigned long long getNumDroppedModemLineEvents(ModemLineMonitor *monitor)
+{
+	return __atomic_load_n(&monitor->numDropped, __ATOMIC_RELAXED);
+}
+
+// Fills in the default port settings: 9600 baud, 8 data bits, 1 stop bit, no parity, no flow control, non-blocking
+void initPortConfig(SerialPortConfig *config)
+{
+	memset(config, 0, sizeof(SerialPortConfig));
+	config->baudRate = 9600;
+	config->dataBits = 8;
+	config->stopBits = SERIAL_ONE_STOP_BIT;
+	config->parity = SERIAL_NO_PARITY;
+	config->timeoutMode = SERIAL_TIMEOUT_NONBLOCKING;
+	config->rs485RtsActiveHigh = true;
+	config->pacingUnits = SERIAL_PACING_MICROSECONDS;
+}
+
+// Sets the character framing and parity in a terminal configuration
+static void setFramingOptions(struct termios *options, const SerialPortConfig *config)
+{
+	tcflag_t byteSize = (config->dataBits == 5) ? CS5 : (config->dataBits == 6) ? CS6 : (config->dataBits == 7) ? CS7 : CS8;
+	tcflag_t stopBits = ((config->stopBits == SERIAL_ONE_STOP_BIT) || (config->stopBits == SERIAL_ONE_POINT_FIVE_STOP_BITS)) ? 0 : CSTOPB;
+	tcflag_t parity = (config->parity == SERIAL_NO_PARITY) ? 0 : (config->parity == SERIAL_ODD_PARITY) ? (PARENB | PARODD) : (config->parity == SERIAL_EVEN_PARITY) ? PARENB : (config->parity == SERIAL_MARK_PARITY) ? (PARENB | CMSPAR | PARODD) : (PARENB | CMSPAR);
+
+	options->c_cflag = (B38400 | byteSize | stopBits | parity | CLOCAL | CREAD);
+	if (config->parity == SERIAL_SPACE_PARITY)
+		options->c_cflag &= ~PARODD;
+	options->c_iflag = ((config->parity > 0) ? (INPCK | ISTRIP) : IGNPAR);
+	options->c_oflag = 0;
+	options->c_lflag = 0;
+}
+
+// Adds the hardware and software flow control settings to a terminal configuration
+static void setFlowControlOptions(struct termios *options, const SerialPortConfig *config)
+{
+	tcflag_t CTSRTSEnabled = (((config->flowControl & SERIAL_FLOW_CONTROL_CTS_ENABLED) > 0) ||
+			((config->flowControl & SERIAL_FLOW_CONTROL_RTS_ENABLED) > 0)) ? CRTSCTS : 0;
+	tcflag_t XonXoffInEnabled = ((config->flowControl & SERIAL_FLOW_CONTROL_XONXOFF_IN_ENABLED) > 0) ? IXOFF : 0;
+	tcflag_t XonXoffOutEnabled = ((config->flowControl & SERIAL_FLOW_CONTROL_XONXOFF_OUT_ENABLED) > 0) ? IXON : 0;
+
+	options->c_cflag |= CTSRTSEnabled;
+	options->c_iflag |= XonXoffInEnabled | XonXoffOutEnabled;
+	options->c_oflag = 0;
+	options->c_lflag = 0;
+}
+
+// Sets the read timeouts in a terminal configuration
+static void setTimeoutOptions(struct termios *options, const SerialPortConfig *config)
+{
+	switch (config->timeoutMode)
+	{
+		case SERIAL_TIMEOUT_READ_SEMI_BLOCKING:		// Read Semi-blocking
+			options->c_cc[VMIN] = 0;
+			options->c_cc[VTIME] = config->readTimeout / 100;
+			break;
+		case SERIAL_TIMEOUT_READ_BLOCKING:			// Read Blocking
+			options->c_cc[VMIN] = 0;
+			options->c_cc[VTIME] = 1;
+			break;
+		case SERIAL_TIMEOUT_NONBLOCKING:			// Non-blocking
+		default:
+			options->c_cc[VMIN] = 0;
+			options->c_cc[VTIME] = 0;
+			break;
+	}
+}
+
+// Allows a custom baud rate (only for true serial ports)
+static void setCustomBaudRate(int portFD, int baudRate)
+{
+	struct serial_struct serialInfo;
+	if ((baudRate > 0) && (ioctl(portFD, TIOCGSERIAL, &serialInfo) == 0))
+	{
+		serialInfo.flags = ASYNC_SPD_CUST | ASYNC_LOW_LATENCY;
+		serialInfo.custom_divisor = serialInfo.baud_base / baudRate;
+		ioctl(portFD, TIOCSSERIAL, &serialInfo);
+	}
+}
+
+// Applies the baud rate, character framing, and parity settings to the port
+bool configurePortParameters(SerialPortHandle *port, const SerialPortConfig *config)
+{
+	struct termios options;
+	int portFD = port->portFD;
+
+	// Use non-blocking I/O so that waits can always be interrupted
+	fcntl(portFD, F_SETFL, O_NONBLOCK);
+
+	// Retrieve existing port configuration and set updated port parameters
+	tcgetattr(portFD, &options);
+	setFramingOptions(&options, config);
+
+	// Apply changes
+	tcsetattr(portFD, TCSAFLUSH, &options);
+	ioctl(portFD, TIOCEXCL);				// Block non-root users from using this port
+	setCustomBaudRate(portFD, config->baudRate);
+	return true;
+}
+
+// Applies the hardware and software flow control settings to the port
+bool configureFlowControl(SerialPortHandle *port, const SerialPortConfig *config)
+{
+	struct termios options;
+	tcgetattr(port->portFD, &options);
+	setFlowControlOptions(&options, config);
+	tcsetattr(port->portFD, TCSAFLUSH, &options);
+	return true;
+}
+
+// Applies the read timeout settings to the port's line discipline
+bool configureTimeouts(SerialPortHandle *port, const SerialPortConfig *config)
+{
+	struct termios options;
+	tcgetattr(port->portFD, &options);
+	setTimeoutOptions(&options, config);
+	return (tcsetattr(port->portFD, TCSAFLUSH, &options) == 0);
+}
+
+// Applies the RS-485 settings to the port, recording in the configuration whether the transmitter must be controlled manually
+bool configureRs485(SerialPortHandle *port, SerialPortConfig *config)
+{
+	// Retrieve existing RS-485 configuration, if supported by the driver
+	struct serial_rs485 rs485Conf;
+	memset(&rs485Conf, 0, sizeof(rs485Conf));
+	bool driverSupport = (ioctl(port->portFD, TIOCGRS485, &rs485Conf) == 0);
+	config->rs485Emulated = false;
+	if (!config->rs485Mode)
+	{
+		if (driverSupport && (rs485Conf.flags & SER_RS485_ENABLED))
+		{
+			rs485Conf.flags &= ~SER_RS485_ENABLED;
+			ioctl(port->portFD, TIOCSRS485, &rs485Conf);
+		}
+		return true;
+	}
+
+	// Hand transmitter control over to the driver if possible (delays are specified in milliseconds)
+	rs485Conf.flags = SER_RS485_ENABLED | (config->rs485RtsActiveHigh ? SER_RS485_RTS_ON_SEND : SER_RS485_RTS_AFTER_SEND) | (config->rs485RxDuringTx ? SER_RS485_RX_DURING_TX : 0);
+	rs485Conf.delay_rts_before_send = (config->rs485DelayBefore + 999) / 1000;
+	rs485Conf.delay_rts_after_send = (config->rs485DelayAfter + 999) / 1000;
+	if (!driverSupport || (ioctl(port->portFD, TIOCSRS485, &rs485Conf) != 0))
+	{
+		// Otherwise, toggle RTS around each write and keep the transmitter disabled in the meantime
+		setRtsLine(port->portFD, !config->rs485RtsActiveHigh);
+		config->rs485Emulated = true;
+	}
+	return true;
+}
+
+// Applies every part of the configuration to the port, changing the terminal settings only once since some drivers are slow to do so
+bool configureSerialPort(SerialPortHandle *port, SerialPortConfig *config)
+{
+	struct termios options;
+	int portFD = port->portFD;
+
+	// Use non-blocking I/O so that waits can always be interrupted
+	fcntl(portFD, F_SETFL, O_NONBLOCK);
+
+	// Combine the port parameters, flow control, and timeouts into a single terminal configuration
+	tcgetattr(portFD, &options);
+	setFramingOptions(&options, config);
+	setFlowControlOptions(&options, config);
+	setTimeoutOptions(&options, config);
+
+	// Apply changes
+	if (tcsetattr(portFD, TCSAFLUSH, &options) != 0)
+		return false;
+	ioctl(portFD, TIOCEXCL);				// Block non-root users from using this port
+	setCustomBaudRate(portFD, config->baudRate);
+	return configureRs485(port, config);
+}
+
+// Opens and configures a port, returning its handle or -1 if it could not be opened or configured
+int64_t openSerialPort(const char *portName, SerialPortConfig *config)
+{
+	int fdSerial;
+	int64_t portHandle;
+	SerialPortHandle *port;
+
+	// Try to open existing serial port with read/write access
+	if ((fdSerial = open(portName, O_RDWR | O_NOCTTY | O_NDELAY | O_CLOEXEC)) <= 0)
+		return -1l;
+	if ((portHandle = createPortHandle(fdSerial)) == -1l)
+	{
+		close(fdSerial);
+		return -1l;
+	}
+
+	// Configure the port parameters and timeouts, closing the port if there was a problem setting them
+	bool configured = ((port = acquirePortHandle(portHandle)) != NULL) && configureSerialPort(port, config);
+	if (port != NULL)
+		releasePortHandle(port);
+	if (!configured)
+	{
+		closePortHandle(portHandle);
+		return -1l;
+	}
+	return portHandle;
+}
+
+// Shared state of the worker threads opening a batch of ports, each of which claims the next unopened port until none are left
+typedef struct PortOpenBatch
+{
+	SerialPortOpenRequest *requests;
+	int numPorts, nextPort;
+} PortOpenBatch;
+
+// Opens ports from a batch on a worker thread
+static void* openPortsFromBatch(void *batchPointer)
+{
+	PortOpenBatch *batch = (PortOpenBatch*)batchPointer;
+	int portIndex;
+	while ((portIndex = __atomic_fetch_add(&batch->nextPort, 1, __ATOMIC_RELAXED)) < batch->numPorts)
+	{
+		SerialPortOpenRequest *request = &batch->requests[portIndex];
+		int64_t startTime = getMonotonicTime();
+		request->portHandle = (request->portName == NULL) ? -1l : openSerialPort(request->portName, &request->config);
+		if (request->portHandle != -1l)
+			findDeviceIdentity(request->portName, request->deviceIdentity, sizeof(request->deviceIdentity));
+		request->openTime = getMonotonicTime() - startTime;
+	}
+	return NULL;
+}
+
+// Opens and configures a batch of ports concurrently on up to maxThreads threads, so that slow drivers are waited on in parallel,
+// returning the number of ports that were opened (any port with a NULL name is skipped)
+int openSerialPorts(SerialPortOpenRequest *requests, int numPorts, int maxThreads)
+{
+	PortOpenBatch batch = { requests, numPorts, 0 };
+	int numThreads = ((maxThreads > 0) && (maxThreads < numPorts)) ? maxThreads : numPorts, numStarted = 0, numOpened = 0;
+	pthread_t *workers = (pthread_t*)malloc(((numThreads > 0) ? numThreads : 1) * sizeof(pthread_t));
+	pthread_attr_t workerAttributes;
+
+	// Start the worker threads with small stacks, since there may be hundreds of them
+	pthread_attr_init(&workerAttributes);
+	pthread_attr_setstacksize(&workerAttributes, 256 * 1024);
+	while ((workers != NULL) && (numStarted < numThreads) && (pthread_create(&workers[numStarted], &workerAttributes, openPortsFromBatch, &batch) == 0))
+		++numStarted;
+	pthread_attr_destroy(&workerAttributes);
+
+	// Take part in the work ourselves, which also finishes the batch if no threads could be started
+	openPortsFromBatch(&batch);
+	for (int i = 0; i < numStarted; ++i)
+		pthread_join(workers[i], NULL);
+	free(workers);
+	for (int i = 0; i < numPorts; ++i)
+		if (requests[i].portHandle != -1l)
+			++numOpened;
+	return numOpened;
+}
+
+// Lists the serial ports on the system in a newly allocated array, which the caller must free, returning the number of ports or -1 on error
+int enumerateSerialPorts(SerialPortInfo **portList)
+{
+	DIR *serialPortIterator;
+	struct dirent *serialPortEntry;
+	int numValues = 0, numChars;
+	char portString[PATH_MAX], comPort[PATH_MAX], pathBase[21] = {"/dev/serial/by-path/"};
+
+	// Enumerate serial ports on machine
+	*portList = NULL;
+	if ((serialPortIterator = opendir(pathBase)) == NULL)
+		return -1;
+	while (readdir(serialPortIterator) != NULL) ++numValues;
+	rewinddir(serialPortIterator);
+	if ((*portList = (SerialPortInfo*)calloc((numValues > 0) ? numValues : 1, sizeof(SerialPortInfo))) == NULL)
+	{
+		closedir(serialPortIterator);
+		return -1;
+	}
+	numValues = 0;
+	while ((serialPortEntry = readdir(serialPortIterator)) != NULL)
+	{
+		// Get serial COM value
+		snprintf(portString, sizeof(portString), "%s%s", pathBase, serialPortEntry->d_name);
+		if ((serialPortEntry->d_name[0] == '.') || ((numChars = readlink(portString, comPort, sizeof(comPort) - 1)) == -1))
+			continue;
+		comPort[numChars] = '\0';
+
+		// Get port name and system path
+		snprintf((*portList)[numValues].portName, sizeof((*portList)[numValues].portName), "%s", strrchr(comPort, '/') + 1);
+		snprintf((*portList)[numValues].systemPath, sizeof((*portList)[numValues].systemPath), "/dev/%s", (*portList)[numValues].portName);
+		++numValues;
+	}
+	closedir(serialPortIterator);
+	return numValues;
+}
+
+// Finds the most stable name for a port device, preferring its USB serial number link over its bus location link
+void findDeviceIdentity(const char *portName, char *identity, int identityLength)
+{
+	const char *linkDirectories[] = { "/dev/serial/by-id/", "/dev/serial/by-path/" };
+	char devicePath[PATH_MAX], linkPath[PATH_MAX], linkTarget[PATH_MAX];
+	struct dirent *linkEntry;
+	DIR *linkIterator;
+
+	snprintf(identity, identityLength, "%s", portName);
+	if (realpath(portName, devicePath) == NULL)
+		return;
+	for (int i = 0; i < 2; ++i)
+	{
+		if ((linkIterator = opendir(linkDirectories[i])) == NULL)
+			continue;
+		while ((linkEntry = readdir(linkIterator)) != NULL)
+		{
+			snprintf(linkPath, sizeof(linkPath), "%s%s", linkDirectories[i], linkEntry->d_name);
+			if ((linkEntry->d_name[0] != '.') && (realpath(linkPath, linkTarget) != NULL) && (strcmp(linkTarget, devicePath) == 0))
+			{
+				snprintf(identity, identityLength, "%s", linkPath);
+				closedir(linkIterator);
+				return;
+			}
+		}
+		closedir(linkIterator);
+	}
+}
+
+SerialPort::SerialPort(void) : portHandle(-1l)
+{
+	pthread_mutex_init(&configLock, NULL);
+	initPortConfig(&config);
+}
+
+SerialPort::~SerialPort(void)
+{
+	close();
+	pthread_mutex_destroy(&configLock);
+}
+
+bool SerialPort::open(const char *portName, const SerialPortConfig *portConfig)
+{
+	SerialPortConfig openConfig;
+	if (isOpen())
+		return false;
+	if (portConfig != NULL)
+		openConfig = *portConfig;
+	else
+		getConfig(&openConfig);
+
+	// The settings may be adjusted to what the port supports while opening it, so store them once that has finished
+	int64_t handle = openSerialPort(portName, &openConfig);
+	pthread_mutex_lock(&configLock);
+	config = openConfig;
+	pthread_mutex_unlock(&configLock);
+	__atomic_store_n(&portHandle, handle, __ATOMIC_RELEASE);
+	return (handle != -1l);
+}
+
+bool SerialPort::configure(const SerialPortConfig *portConfig)
+{
+	SerialPortHandle *port;
+	SerialPortConfig newConfig = *portConfig;
+	bool configured = !isOpen();
+	if ((port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE))) != NULL)
+	{
+		configured = configureSerialPort(port, &newConfig);
+		releasePortHandle(port);
+	}
+
+	// Publish the new settings as a whole, so that a read or write starting on another thread never sees a partial update
+	pthread_mutex_lock(&configLock);
+	config = newConfig;
+	pthread_mutex_unlock(&configLock);
+	return configured;
+}
+
+void SerialPort::close(void)
+{
+	int64_t handle = __atomic_exchange_n(&portHandle, -1l, __ATOMIC_ACQ_REL);
+	closePortHandle(handle);
+}
+
+bool SerialPort::isOpen(void) const
+{
+	return (__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE) != -1l);
+}
+
+int SerialPort::bytesAvailable(void)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return -1;
+	int numBytesAvailable = getBytesAvailable(port);
+	releasePortHandle(port);
+	return numBytesAvailable;
+}
+
+int SerialPort::read(void *buffer, int bytesToRead)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return -1;
+	pthread_mutex_lock(&configLock);
+	int timeoutMode = config.timeoutMode, readTimeout = config.readTimeout;
+	pthread_mutex_unlock(&configLock);
+	int numBytesRead = readFromPort(port, buffer, bytesToRead, timeoutMode, readTimeout);
+	releasePortHandle(port);
+	return numBytesRead;
+}
+
+int SerialPort::write(const void *buffer, int bytesToWrite)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return -1;
+	SerialPortConfig writeConfig;
+	getConfig(&writeConfig);
+	int numBytesWritten = writeToPort(port, &writeConfig, buffer, bytesToWrite, NULL);
+	releasePortHandle(port);
+	return numBytesWritten;
+}
+
+int SerialPort::poll(short events, int timeout)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return -1;
+	int waitResult = waitForPort(port, events, (timeout < 0) ? -1 : (timeout * 1000000ll));
+	releasePortHandle(port);
+	return waitResult;
+}
+
+int SerialPort::getModemLines(void)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return -1;
+	int lineStates = ::getModemLines(port);
+	releasePortHandle(port);
+	return lineStates;
+}
+
+bool SerialPort::setModemLines(int lines, bool asserted)
+{
+	SerialPortHandle *port = acquirePortHandle(__atomic_load_n(&portHandle, __ATOMIC_ACQUIRE));
+	if (port == NULL)
+		return false;
+	bool success = ::setModemLines(port, lines, asserted);
+	releasePortHandle(port);
+	return success;
+}
+
+void SerialPort::getConfig(SerialPortConfig *portConfig) const
+{
+	pthread_mutex_lock(&configLock);
+	*portConfig = config;
+	pthread_mutex_unlock(&configLock);
+}
+
+int64_t SerialPort::getHandle(void) const
+{
+	return __atomic_load_n(&portHandle, __ATOMIC_ACQUIRE);
+}
+
+int SerialPort::enumerate(SerialPortInfo **portList)
+{
+	return enumerateSerialPorts(portList);
+}
+
+#endif
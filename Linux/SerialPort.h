@@ -0,0 +1,176 @@
+/*
+ * SerialPort.h
+ *
+ *       Created on:  Feb 25, 2012
+ *  Last Updated on:  Mar 14, 2013
+ *           Author:  Will Hedgecock
+ *
+ * Copyright (C) 2012-2013 Will Hedgecock
+ *
+ * This file is part of SerialComm.
+ *
+ * SerialComm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SerialComm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SerialComm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERIALPORT_H_
+#define SERIALPORT_H_
+
+#include <stdint.h>
+#include <climits>
+#include <pthread.h>
+
+// Port settings, using the same values as the corresponding constants in SerialComm.java
+enum SerialParity { SERIAL_NO_PARITY = 0, SERIAL_ODD_PARITY, SERIAL_EVEN_PARITY, SERIAL_MARK_PARITY, SERIAL_SPACE_PARITY };
+enum SerialStopBits { SERIAL_ONE_STOP_BIT = 1, SERIAL_ONE_POINT_FIVE_STOP_BITS, SERIAL_TWO_STOP_BITS };
+enum SerialFlowControl { SERIAL_FLOW_CONTROL_DISABLED = 0x00000000, SERIAL_FLOW_CONTROL_RTS_ENABLED = 0x00000001,
+	SERIAL_FLOW_CONTROL_CTS_ENABLED = 0x00000010, SERIAL_FLOW_CONTROL_DSR_ENABLED = 0x00000100, SERIAL_FLOW_CONTROL_DTR_ENABLED = 0x00001000,
+	SERIAL_FLOW_CONTROL_XONXOFF_IN_ENABLED = 0x00010000, SERIAL_FLOW_CONTROL_XONXOFF_OUT_ENABLED = 0x00100000 };
+enum SerialTimeoutMode { SERIAL_TIMEOUT_NONBLOCKING = 0x00000000, SERIAL_TIMEOUT_READ_SEMI_BLOCKING = 0x00000001,
+	SERIAL_TIMEOUT_WRITE_SEMI_BLOCKING = 0x00000010, SERIAL_TIMEOUT_READ_BLOCKING = 0x00000100, SERIAL_TIMEOUT_WRITE_BLOCKING = 0x00001000 };
+enum SerialPacingUnits { SERIAL_PACING_MICROSECONDS = 0, SERIAL_PACING_CHARACTER_TIMES = 1 };
+enum SerialModemLines { SERIAL_LINE_CTS = 0x01, SERIAL_LINE_DSR = 0x02, SERIAL_LINE_DCD = 0x04, SERIAL_LINE_RI = 0x08,
+	SERIAL_LINE_DTR = 0x10, SERIAL_LINE_RTS = 0x20 };
+
+// Layout of the transmit pacing statistics reported by a paced write
+#define PACING_BYTE_GAP_COUNT		0
+#define PACING_BYTE_GAP_TOTAL		1
+#define PACING_BYTE_GAP_MIN			2
+#define PACING_BYTE_GAP_MAX			3
+#define PACING_FRAME_GAP_COUNT		4
+#define PACING_FRAME_GAP_TOTAL		5
+#define PACING_FRAME_GAP_MIN		6
+#define PACING_FRAME_GAP_MAX		7
+#define PACING_BYTE_GAP_REQUESTED	8
+#define PACING_FRAME_GAP_REQUESTED	9
+#define PACING_NUM_STATISTICS		10
+
+// Complete configuration of a port (timeouts in milliseconds, RS-485 delays in microseconds, pacing gaps in pacingUnits)
+typedef struct SerialPortConfig
+{
+	int baudRate, dataBits, stopBits, parity, flowControl;
+	int timeoutMode, readTimeout, writeTimeout;
+	bool rs485Mode, rs485RtsActiveHigh, rs485RxDuringTx, rs485Emulated;
+	int rs485DelayBefore, rs485DelayAfter;
+	double pacingInterByteGap, pacingInterFrameGap;
+	int pacingUnits;
+} SerialPortConfig;
+
+// An open port, shared by every thread using it until the last of them releases its reference
+typedef struct SerialPortHandle
+{
+	unsigned long long state;
+	int portFD, eventFD, timerFD;
+	int64_t lastTransmitEnd;
+	pthread_t modemWaitThread;
+	int modemWaitState;
+} SerialPortHandle;
+
+// A port found on the system
+typedef struct SerialPortInfo
+{
+	char portName[256], systemPath[5 + 256];		// Room for the "/dev/" prefix in front of any port name
+} SerialPortInfo;
+
+// A port to be opened by openSerialPorts(), along with the result of opening it (the open time is in nanoseconds)
+typedef struct SerialPortOpenRequest
+{
+	const char *portName;
+	SerialPortConfig config;
+	int64_t portHandle, openTime;
+	char deviceIdentity[PATH_MAX];
+} SerialPortOpenRequest;
+
+// A change of the modem control lines, timestamped on the monotonic clock as soon as the kernel reported it (changedLines
+// includes lines that toggled and returned to their previous state before the change could be read)
+typedef struct ModemLineEvent
+{
+	int64_t timestamp;
+	int lineStates, changedLines;
+} ModemLineEvent;
+typedef struct ModemLineMonitor ModemLineMonitor;
+
+// Port handles, which remain safe to use from any thread after the port has been closed
+int64_t createPortHandle(int portFD);
+SerialPortHandle* acquirePortHandle(int64_t handle);
+void releasePortHandle(SerialPortHandle *port);
+bool closePortHandle(int64_t handle);
+bool lockPortHandles(void);
+
+// Opening, configuring, and enumerating ports
+void initPortConfig(SerialPortConfig *config);
+int64_t openSerialPort(const char *portName, SerialPortConfig *config);
+int openSerialPorts(SerialPortOpenRequest *requests, int numPorts, int maxThreads);
+bool configurePortParameters(SerialPortHandle *port, const SerialPortConfig *config);
+bool configureFlowControl(SerialPortHandle *port, const SerialPortConfig *config);
+bool configureTimeouts(SerialPortHandle *port, const SerialPortConfig *config);
+bool configureRs485(SerialPortHandle *port, SerialPortConfig *config);
+bool configureSerialPort(SerialPortHandle *port, SerialPortConfig *config);
+int enumerateSerialPorts(SerialPortInfo **portList);
+void findDeviceIdentity(const char *portName, char *identity, int identityLength);
+
+// Waiting, reading, and writing
+int64_t getMonotonicTime(void);
+void sleepUntil(int64_t wakeTime);
+void preciseSleep(long microseconds);
+int waitForPort(SerialPortHandle *port, short events, int64_t timeoutNanos);
+int drainOutput(SerialPortHandle *port, int64_t charTime);
+void setRtsLine(int portFD, bool asserted);
+int64_t getCharacterTime(const SerialPortConfig *config);
+bool getPacingGaps(const SerialPortConfig *config, int64_t *interByteGap, int64_t *interFrameGap);
+int getBytesAvailable(SerialPortHandle *port);
+int readFromPort(SerialPortHandle *port, void *buffer, int bytesToRead, int timeoutMode, int readTimeout);
+int readAvailableFromPort(SerialPortHandle *port, void *buffer, int bytesToRead);
+int writeToPort(SerialPortHandle *port, const SerialPortConfig *config, const void *buffer, int bytesToWrite, int64_t *pacingStatistics);
+
+// Modem control lines
+int getModemLines(SerialPortHandle *port);
+bool setModemLines(SerialPortHandle *port, int lines, bool asserted);
+ModemLineMonitor* startModemLineMonitor(int64_t portHandle, int lineMask);
+void stopModemLineMonitor(ModemLineMonitor *monitor);
+void destroyModemLineMonitor(ModemLineMonitor *monitor);
+int readModemLineEvents(ModemLineMonitor *monitor, ModemLineEvent *events, int maxEvents, int64_t timeoutNanos);
+unsigned long long getNumDroppedModemLineEvents(ModemLineMonitor *monitor);
+
+// Object interface to a single port for native applications; every method may be called while another thread is blocked in read(),
+// and reads and writes use a copy of the settings taken when they start, so a concurrent configure() applies from the next call
+class SerialPort
+{
+public:
+	SerialPort(void);
+	~SerialPort(void);
+
+	bool open(const char *portName, const SerialPortConfig *portConfig);
+	bool configure(const SerialPortConfig *portConfig);
+	void close(void);
+	bool isOpen(void) const;
+	int bytesAvailable(void);
+	int read(void *buffer, int bytesToRead);
+	int write(const void *buffer, int bytesToWrite);
+	int poll(short events, int timeout);
+	int getModemLines(void);
+	bool setModemLines(int lines, bool asserted);
+	void getConfig(SerialPortConfig *portConfig) const;
+	int64_t getHandle(void) const;
+	static int enumerate(SerialPortInfo **portList);
+
+private:
+	SerialPort(const SerialPort&);
+	SerialPort& operator=(const SerialPort&);
+
+	volatile int64_t portHandle;
+	mutable pthread_mutex_t configLock;
+	SerialPortConfig config;
+};
+
+#endif /* SERIALPORT_H_ */
@@ -0,0 +1,341 @@
+/*
+ * SerialPortTest.cpp
+ *
+ *       Created on:  Feb 25, 2012
+ *  Last Updated on:  Mar 14, 2013
+ *           Author:  Will Hedgecock
+ *
+ * Copyright (C) 2012-2013 Will Hedgecock
+ *
+ * This file is part of SerialComm.
+ *
+ * SerialComm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SerialComm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SerialComm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef __linux__
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <pty.h>
+#include <pthread.h>
+#include "SerialPort.h"
+
+// Tests and benchmarks of the serial port library, run against pseudo-terminals so that no hardware is needed
+#define NUM_PARALLEL_PORTS			8
+#define NUM_CONFIGURATIONS			2000
+#define BENCHMARK_BYTES				(16 * 1024 * 1024)
+
+static int numFailures = 0;
+
+// Reports the outcome of a single check
+static void check(const char *description, bool passed)
+{
+	printf("%-64s %s\n", description, passed ? "ok" : "FAILED");
+	if (!passed)
+		++numFailures;
+}
+
+// A pseudo-terminal whose slave side is opened as the serial port under test and whose master side plays the remote device
+typedef struct PseudoTerminal
+{
+	int masterFD, slaveFD;
+	char slaveName[PATH_MAX];
+} PseudoTerminal;
+
+// Creates a pseudo-terminal, keeping the slave side open so that the master never sees a hangup between tests
+static bool openPseudoTerminal(PseudoTerminal *terminal)
+{
+	struct termios options;
+	if (openpty(&terminal->masterFD, &terminal->slaveFD, terminal->slaveName, NULL, NULL) != 0)
+		return false;
+	tcgetattr(terminal->masterFD, &options);
+	cfmakeraw(&options);
+	tcsetattr(terminal->masterFD, TCSANOW, &options);
+	return true;
+}
+
+static void closePseudoTerminal(PseudoTerminal *terminal)
+{
+	close(terminal->masterFD);
+	close(terminal->slaveFD);
+}
+
+// Writes all of the data to a descriptor, waiting whenever it would block
+static bool writeFully(int fd, const unsigned char *buffer, int length)
+{
+	struct pollfd waitingSet = { fd, POLLOUT, 0 };
+	while (length > 0)
+	{
+		int numBytesWritten = write(fd, buffer, length);
+		if (numBytesWritten > 0)
+		{
+			buffer += numBytesWritten;
+			length -= numBytesWritten;
+		}
+		else if ((numBytesWritten == -1) && (errno != EAGAIN) && (errno != EINTR))
+			return false;
+		else
+			poll(&waitingSet, 1, 1000);
+	}
+	return true;
+}
+
+// Reads exactly the requested number of bytes from a descriptor, giving up after one second without data
+static bool readFully(int fd, unsigned char *buffer, int length)
+{
+	struct pollfd waitingSet = { fd, POLLIN, 0 };
+	while (length > 0)
+	{
+		if (poll(&waitingSet, 1, 1000) <= 0)
+			return false;
+		int numBytesRead = read(fd, buffer, length);
+		if ((numBytesRead <= 0) && (errno != EAGAIN) && (errno != EINTR))
+			return false;
+		else if (numBytesRead > 0)
+		{
+			buffer += numBytesRead;
+			length -= numBytesRead;
+		}
+	}
+	return true;
+}
+
+// Settings for a port that waits up to one second for any data to arrive
+static void initTestConfig(SerialPortConfig *config, int timeoutMode)
+{
+	initPortConfig(config);
+	config->baudRate = 115200;
+	config->timeoutMode = timeoutMode;
+	config->readTimeout = 1000;
+}
+
+static void testReadWrite(PseudoTerminal *terminal)
+{
+	SerialPort port;
+	SerialPortConfig config;
+	unsigned char buffer[64];
+	initTestConfig(&config, SERIAL_TIMEOUT_READ_SEMI_BLOCKING);
+	check("open pseudo-terminal", port.open(terminal->slaveName, &config));
+
+	// Data must pass unchanged in both directions
+	writeFully(terminal->masterFD, (const unsigned char*)"request", 7);
+	check("read data written by the device", (port.read(buffer, sizeof(buffer)) == 7) && (memcmp(buffer, "request", 7) == 0));
+	check("write data to the device", (port.write("response", 8) == 8) && readFully(terminal->masterFD, buffer, 8) &&
+			(memcmp(buffer, "response", 8) == 0));
+
+	// A read of nothing returns immediately without being mistaken for a hangup
+	check("zero-length read returns 0", port.read(buffer, 0) == 0);
+	check("zero-length read leaves the port open", port.isOpen() && (port.bytesAvailable() == 0));
+	writeFully(terminal->masterFD, (const unsigned char*)"x", 1);
+	check("port still reads after a zero-length read", port.read(buffer, sizeof(buffer)) == 1);
+
+	// A semi-blocking read with nothing to read times out without failing
+	int64_t startTime = getMonotonicTime();
+	check("semi-blocking read times out with no data", port.read(buffer, sizeof(buffer)) == 0);
+	check("read timeout is honored", (getMonotonicTime() - startTime) >= 900000000ll);
+	port.close();
+	check("closed port rejects reads", port.read(buffer, sizeof(buffer)) == -1);
+}
+
+// State shared with a thread blocked reading from a port
+typedef struct BlockedRead
+{
+	SerialPort *port;
+	int result;
+	int64_t returnTime;
+} BlockedRead;
+
+static void* readUntilClosed(void *readPointer)
+{
+	BlockedRead *blockedRead = (BlockedRead*)readPointer;
+	unsigned char buffer[64];
+	blockedRead->result = blockedRead->port->read(buffer, sizeof(buffer));
+	blockedRead->returnTime = getMonotonicTime();
+	return NULL;
+}
+
+static void testCloseWakesReader(PseudoTerminal *terminal)
+{
+	SerialPort port;
+	SerialPortConfig config;
+	initTestConfig(&config, SERIAL_TIMEOUT_READ_BLOCKING);
+	config.readTimeout = 0;
+	check("open port for blocking read", port.open(terminal->slaveName, &config));
+
+	// Closing the port must wake a thread that would otherwise wait forever
+	BlockedRead blockedRead = { &port, 0, 0 };
+	pthread_t readerThread;
+	pthread_create(&readerThread, NULL, readUntilClosed, &blockedRead);
+	preciseSleep(100000);
+	int64_t closeTime = getMonotonicTime();
+	port.close();
+	pthread_join(readerThread, NULL);
+	check("close wakes a blocked reader with an error", blockedRead.result == -1);
+	check("blocked reader wakes within 10 ms of close", (blockedRead.returnTime - closeTime) < 10000000ll);
+	printf("  close-to-wakeup latency: %.1f us\n", (blockedRead.returnTime - closeTime) / 1000.0);
+}
+
+// State shared with a thread that keeps reading while the port is being reconfigured
+typedef struct ConcurrentRead
+{
+	SerialPort *port;
+	bool stopping;
+	int numErrors;
+} ConcurrentRead;
+
+static void* readWhileConfiguring(void *readPointer)
+{
+	ConcurrentRead *concurrentRead = (ConcurrentRead*)readPointer;
+	unsigned char buffer[64];
+	while (!__atomic_load_n(&concurrentRead->stopping, __ATOMIC_ACQUIRE))
+		if (concurrentRead->port->read(buffer, sizeof(buffer)) < 0)
+			++concurrentRead->numErrors;
+	return NULL;
+}
+
+static void testConcurrentConfigure(PseudoTerminal *terminal)
+{
+	SerialPort port;
+	SerialPortConfig config, currentConfig;
+	unsigned char buffer[64];
+	initTestConfig(&config, SERIAL_TIMEOUT_READ_SEMI_BLOCKING);
+	config.readTimeout = 1;
+	check("open port for concurrent configuration", port.open(terminal->slaveName, &config));
+
+	// Reconfigure the port over and over while another thread is reading and this thread is writing
+	ConcurrentRead concurrentRead = { &port, false, 0 };
+	pthread_t readerThread;
+	bool allConfigured = true, allWritten = true;
+	pthread_create(&readerThread, NULL, readWhileConfiguring, &concurrentRead);
+	for (int i = 0; i < NUM_CONFIGURATIONS; ++i)
+	{
+		config.baudRate = (i & 1) ? 9600 : 115200;
+		config.timeoutMode = (i & 2) ? SERIAL_TIMEOUT_NONBLOCKING : SERIAL_TIMEOUT_READ_SEMI_BLOCKING;
+		allConfigured = port.configure(&config) && allConfigured;
+		allWritten = (port.write("ping", 4) == 4) && readFully(terminal->masterFD, buffer, 4) && (memcmp(buffer, "ping", 4) == 0) && allWritten;
+	}
+	__atomic_store_n(&concurrentRead.stopping, true, __ATOMIC_RELEASE);
+	pthread_join(readerThread, NULL);
+	check("every reconfiguration succeeds", allConfigured);
+	check("writes succeed while reconfiguring", allWritten);
+	check("reads never fail while reconfiguring", concurrentRead.numErrors == 0);
+
+	// The settings read back are those most recently applied, as a whole
+	port.getConfig(&currentConfig);
+	check("configuration reads back consistently", (currentConfig.baudRate == config.baudRate) &&
+			(currentConfig.timeoutMode == config.timeoutMode) && (currentConfig.readTimeout == config.readTimeout));
+	port.close();
+}
+
+static void testParallelOpen(void)
+{
+	PseudoTerminal terminals[NUM_PARALLEL_PORTS];
+	SerialPortOpenRequest requests[NUM_PARALLEL_PORTS];
+	memset(requests, 0, sizeof(requests));
+	for (int i = 0; i < NUM_PARALLEL_PORTS; ++i)
+	{
+		openPseudoTerminal(&terminals[i]);
+		requests[i].portName = terminals[i].slaveName;
+		initTestConfig(&requests[i].config, SERIAL_TIMEOUT_NONBLOCKING);
+	}
+
+	// Every port must open, each with its own handle
+	int64_t startTime = getMonotonicTime();
+	int numOpened = openSerialPorts(requests, NUM_PARALLEL_PORTS, 4);
+	int64_t elapsedTime = getMonotonicTime() - startTime;
+	bool allDistinct = true;
+	for (int i = 0; i < NUM_PARALLEL_PORTS; ++i)
+		for (int j = i + 1; j < NUM_PARALLEL_PORTS; ++j)
+			allDistinct = allDistinct && (requests[i].portHandle != requests[j].portHandle);
+	check("open ports in parallel", numOpened == NUM_PARALLEL_PORTS);
+	check("parallel opens return distinct handles", allDistinct);
+	printf("  opened %d ports in %.1f us\n", numOpened, elapsedTime / 1000.0);
+	for (int i = 0; i < NUM_PARALLEL_PORTS; ++i)
+	{
+		closePortHandle(requests[i].portHandle);
+		closePseudoTerminal(&terminals[i]);
+	}
+}
+
+// State shared with the thread playing a device that streams data as fast as possible
+typedef struct StreamingDevice
+{
+	int masterFD;
+	bool succeeded;
+} StreamingDevice;
+
+static void* streamToPort(void *devicePointer)
+{
+	StreamingDevice *device = (StreamingDevice*)devicePointer;
+	unsigned char buffer[4096];
+	for (int i = 0; i < (int)sizeof(buffer); ++i)
+		buffer[i] = (unsigned char)i;
+	device->succeeded = true;
+	for (int numBytesSent = 0; device->succeeded && (numBytesSent < BENCHMARK_BYTES); numBytesSent += sizeof(buffer))
+		device->succeeded = writeFully(device->masterFD, buffer, sizeof(buffer));
+	return NULL;
+}
+
+static void benchmarkReadThroughput(PseudoTerminal *terminal)
+{
+	SerialPort port;
+	SerialPortConfig config;
+	unsigned char buffer[4096];
+	initTestConfig(&config, SERIAL_TIMEOUT_READ_SEMI_BLOCKING);
+	check("open port for throughput benchmark", port.open(terminal->slaveName, &config));
+
+	// Receive a long stream in large reads, checking that no byte was lost or reordered
+	StreamingDevice device = { terminal->masterFD, false };
+	pthread_t deviceThread;
+	int numBytesReceived = 0, numBytesRead = 0;
+	bool inOrder = true;
+	int64_t startTime = getMonotonicTime();
+	pthread_create(&deviceThread, NULL, streamToPort, &device);
+	while ((numBytesReceived < BENCHMARK_BYTES) && ((numBytesRead = port.read(buffer, sizeof(buffer))) > 0))
+	{
+		for (int i = 0; i < numBytesRead; ++i)
+			inOrder = inOrder && (buffer[i] == (unsigned char)(numBytesReceived + i));
+		numBytesReceived += numBytesRead;
+	}
+	int64_t elapsedTime = getMonotonicTime() - startTime;
+	pthread_join(deviceThread, NULL);
+	check("receive stream without loss", device.succeeded && (numBytesReceived == BENCHMARK_BYTES));
+	check("receive stream in order", inOrder);
+	printf("  read throughput: %.1f MB/s\n", (numBytesReceived / 1048576.0) / (elapsedTime / 1000000000.0));
+	port.close();
+}
+
+int main(void)
+{
+	PseudoTerminal terminal;
+	if (!openPseudoTerminal(&terminal))
+	{
+		printf("Unable to create a pseudo-terminal: %s\n", strerror(errno));
+		return 1;
+	}
+	testReadWrite(&terminal);
+	testCloseWakesReader(&terminal);
+	testConcurrentConfigure(&terminal);
+	testParallelOpen();
+	benchmarkReadThroughput(&terminal);
+	closePseudoTerminal(&terminal);
+
+	printf("%d check%s failed\n", numFailures, (numFailures == 1) ? "" : "s");
+	return (numFailures == 0) ? 0 : 1;
+}
+
+#endif
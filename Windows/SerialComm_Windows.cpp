@@ -316,6 +316,79 @@ JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readBytes(JNIEnv *env,
 	return (result == TRUE) ? numBytesRead : -1;
 }
 
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readAvailableBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jint offset, jint bytesToRead)
+{
+	jclass serialCommClass = env->GetObjectClass(obj);
+	jfieldID isOpenedID = env->GetFieldID(serialCommClass, "isOpened", "Z");
+	HANDLE serialPortHandle = (HANDLE)env->GetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"));
+	OVERLAPPED readOverlapped = {0}, waitOverlapped = {0};
+	COMSTAT commInfo;
+	jbyte readBuffer[4096];
+	DWORD numBytesRead = 0, numToRead, eventMask = 0, unused;
+	BOOL result = TRUE, waitPending = FALSE;
+	if (bytesToRead > (jint)sizeof(readBuffer))
+		bytesToRead = sizeof(readBuffer);
+
+	// Wait for data using receive events instead of changing the port's timeouts, which a concurrent readBytes() relies on
+	if (!GetCommMask(serialPortHandle, &eventMask) || (((eventMask & EV_RXCHAR) == 0) && !SetCommMask(serialPortHandle, eventMask | EV_RXCHAR)))
+		result = FALSE;
+	readOverlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	waitOverlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	while ((result != FALSE) && (numBytesRead == 0) && env->GetBooleanField(obj, isOpenedID))
+	{
+		// Read whatever has already been received, which completes immediately under any timeout settings
+		if ((result = ClearCommError(serialPortHandle, NULL, &commInfo)) == FALSE)
+			break;
+		else if (commInfo.cbInQue > 0)
+		{
+			numToRead = (commInfo.cbInQue < (DWORD)bytesToRead) ? commInfo.cbInQue : (DWORD)bytesToRead;
+			ResetEvent(readOverlapped.hEvent);
+			if (((result = ReadFile(serialPortHandle, readBuffer, numToRead, &numBytesRead, &readOverlapped)) == FALSE) && (GetLastError() == ERROR_IO_PENDING))
+				result = GetOverlappedResult(serialPortHandle, &readOverlapped, &numBytesRead, TRUE);
+			continue;
+		}
+
+		// Arm the receive event, then check the queue once more since data that arrived earlier may not be signalled
+		if (!waitPending)
+		{
+			ResetEvent(waitOverlapped.hEvent);
+			if (!WaitCommEvent(serialPortHandle, &eventMask, &waitOverlapped) && ((result = (GetLastError() == ERROR_IO_PENDING)) != FALSE))
+				waitPending = TRUE;
+			continue;
+		}
+
+		// Sleep until a character arrives, waking up periodically so that a port closed from another thread is noticed
+		if (WaitForSingleObject(waitOverlapped.hEvent, 500) == WAIT_OBJECT_0)
+		{
+			waitPending = FALSE;
+			result = GetOverlappedResult(serialPortHandle, &waitOverlapped, &unused, FALSE);
+		}
+	}
+	if (waitPending)
+	{
+		CancelIo(serialPortHandle);
+		GetOverlappedResult(serialPortHandle, &waitOverlapped, &unused, TRUE);
+	}
+	CloseHandle(readOverlapped.hEvent);
+	CloseHandle(waitOverlapped.hEvent);
+
+	// Return number of bytes read if successful
+	if ((result != FALSE) && (numBytesRead > 0))
+	{
+		env->SetByteArrayRegion(buffer, offset, numBytesRead, readBuffer);
+		return (jint)numBytesRead;
+	}
+	else if ((result == FALSE) && env->GetBooleanField(obj, isOpenedID))
+	{
+		// Problem reading, close port
+		CloseHandle(serialPortHandle);
+		serialPortHandle = INVALID_HANDLE_VALUE;
+		env->SetLongField(obj, env->GetFieldID(serialCommClass, "portHandle", "J"), (jlong)INVALID_HANDLE_VALUE);
+		env->SetBooleanField(obj, isOpenedID, JNI_FALSE);
+	}
+	return -1;
+}
+
 JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytes(JNIEnv *env, jobject obj, jbyteArray buffer, jlong bytesToWrite)
 {
 	HANDLE serialPortHandle = (HANDLE)env->GetLongField(obj, env->GetFieldID(env->GetObjectClass(obj), "portHandle", "J"));
@@ -366,4 +439,199 @@ JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytes(JNIEnv *env,
 	return (result == TRUE) ? numBytesWritten : -1;
 }
 
+// The following features are currently only implemented on Linux, so they report failure on this platform
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_setNativeTraceEnabled(JNIEnv *env, jclass serialCommClass, jboolean enabled)
+{
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_dumpNativeTrace(JNIEnv *env, jclass serialCommClass, jstring fileName)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_configRs485(JNIEnv *env, jobject obj)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_executeTransactionCycles(JNIEnv *env, jobject obj, jobject schedule, jobject results, jint numCycles)
+{
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeBytesToPorts(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jbyteArray buffer, jlong bytesToWrite, jintArray bytesWritten, jlongArray writeTimes)
+{
+	// Report every port as failed, so that no stale per-port results are returned
+	for (jint i = 0, numPorts = env->GetArrayLength(bytesWritten); i < numPorts; ++i)
+	{
+		jint failed = -1;
+		env->SetIntArrayRegion(bytesWritten, i, 1, &failed);
+	}
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readBytesFromPorts(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jbyteArray buffer, jint bytesPerPort, jintArray bytesRead, jlongArray arrivalTimes, jint timeout)
+{
+	return -1;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_applyRealtimeParameters(JNIEnv *env, jobject obj)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_measureWakeupLatencies(JNIEnv *env, jobject obj, jobject histogram, jint numSamples, jint interval)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createGnssParser(JNIEnv *env, jclass serialCommClass, jobject messageBuffer, jint maxMessageLength)
+{
+	return 0;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyGnssParser(JNIEnv *env, jclass serialCommClass, jlong parserState)
+{
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_parseGnssData(JNIEnv *env, jclass serialCommClass, jobject parserObj, jbyteArray data, jint offset, jint length)
+{
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readGnssData(JNIEnv *env, jobject obj, jobject parserObj, jint timeout)
+{
+	return -1;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_transmitFile(JNIEnv *env, jobject obj, jstring fileName, jlong offset, jlong length, jint protocol)
+{
+	return -2;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createPortBroker(JNIEnv *env, jclass serialCommClass, jstring brokerName, jint ringSize, jint writeRingSize)
+{
+	return 0;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_attachPortBroker(JNIEnv *env, jclass serialCommClass, jstring brokerName)
+{
+	return 0;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_stopPortBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_detachPortBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_publishToBroker(JNIEnv *env, jobject obj, jlong brokerState)
+{
+	return -1;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_transmitFromBroker(JNIEnv *env, jobject obj, jlong brokerState)
+{
+	return -1;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_brokerBytesAvailable(JNIEnv *env, jclass serialCommClass, jlong brokerState)
+{
+	return -1;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readFromBroker(JNIEnv *env, jclass serialCommClass, jobject clientObj, jbyteArray buffer, jint offset, jint length, jint timeout)
+{
+	return -1;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_writeToBroker(JNIEnv *env, jclass serialCommClass, jlong brokerState, jbyteArray buffer, jint offset, jint length)
+{
+	return -1;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createExpectAutomaton(JNIEnv *env, jclass serialCommClass, jobjectArray patterns)
+{
+	return 0;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyExpectAutomaton(JNIEnv *env, jclass serialCommClass, jlong automatonState)
+{
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readUntilMatch(JNIEnv *env, jobject obj, jobject patternsObj, jobject resultObj, jint timeout)
+{
+	return -2;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_waitForHangup(JNIEnv *env, jobject obj)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jstring JNICALL Java_j_extensions_comm_SerialComm_waitForDevice(JNIEnv *env, jclass serialCommClass, jstring deviceIdentity, jint timeout)
+{
+	return NULL;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createReceiveBufferPool(JNIEnv *env, jclass serialCommClass, jint numBuffers, jint bufferSize)
+{
+	return 0;
+}
+
+JNIEXPORT jobject JNICALL Java_j_extensions_comm_SerialComm_getReceiveBuffer(JNIEnv *env, jclass serialCommClass, jlong poolState, jint index)
+{
+	return NULL;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyReceiveBufferPool(JNIEnv *env, jclass serialCommClass, jlong poolState)
+{
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readIntoPooledBuffer(JNIEnv *env, jobject obj, jobject bufferObj, jint timeout)
+{
+	return -1;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_openPortsInParallel(JNIEnv *env, jclass serialCommClass, jobjectArray ports, jlongArray openTimes, jint maxThreads)
+{
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_getModemLines(JNIEnv *env, jobject obj)
+{
+	return -1;
+}
+
+JNIEXPORT jboolean JNICALL Java_j_extensions_comm_SerialComm_setModemLine(JNIEnv *env, jobject obj, jint line, jboolean asserted)
+{
+	return JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_createModemLineMonitor(JNIEnv *env, jobject obj, jint lineMask)
+{
+	return 0;
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_stopModemLineMonitor(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+}
+
+JNIEXPORT void JNICALL Java_j_extensions_comm_SerialComm_destroyModemLineMonitor(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+}
+
+JNIEXPORT jint JNICALL Java_j_extensions_comm_SerialComm_readModemLineEvents(JNIEnv *env, jclass serialCommClass, jlong monitorState, jlongArray timestamps, jintArray lineStates, jintArray changedLines, jint timeout)
+{
+	return -1;
+}
+
+JNIEXPORT jlong JNICALL Java_j_extensions_comm_SerialComm_getNumDroppedModemLineEvents(JNIEnv *env, jclass serialCommClass, jlong monitorState)
+{
+	return 0;
+}
+
 #endif
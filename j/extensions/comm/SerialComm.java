@@ -25,11 +25,17 @@
 
 package j.extensions.comm;
 
+import java.io.ByteArrayOutputStream;
 import java.io.File;
+import java.io.FileInputStream;
 import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
+import java.io.PrintStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
 
 /**
  * This class provides native access to serial ports and devices without requiring external libraries or tools.
@@ -117,6 +123,83 @@ public class SerialComm
 	 */
 	static public native SerialComm[] getCommPorts();
 	
+	/**
+	 * Opens and configures a group of serial ports concurrently.
+	 * <p>
+	 * Every port is opened on its own native worker thread, and its port parameters, flow control, and timeouts are applied
+	 * to the driver in a single step.  Ports whose drivers are slow to reconfigure are therefore waited on in parallel, so
+	 * the whole group is typically ready after about the time it takes to open its slowest member.
+	 * <p>
+	 * If <i>settings</i> is not null, its port parameters, flow control, timeouts, and RS-485 settings are copied to every port
+	 * before it is opened.  Otherwise, each port is opened with its own settings.  Ports that could not be opened are left closed
+	 * and are reported in the returned results.
+	 * <p>
+	 * Opening ports in bulk is currently only supported on Linux.
+	 * 
+	 * @param ports The serial ports to open.
+	 * @param settings A port whose settings are applied to every port, or null.
+	 * @return The per-port results and timing of the open operation.
+	 * @see OpenResults
+	 */
+	static public final OpenResults openPorts(SerialComm[] ports, SerialComm settings) { return openPorts(ports, settings, 0); }
+	
+	/**
+	 * Opens and configures a group of serial ports concurrently, using at most <i>maxThreads</i> native worker threads.
+	 * 
+	 * @param ports The serial ports to open.
+	 * @param settings A port whose settings are applied to every port, or null.
+	 * @param maxThreads The maximum number of ports to open at the same time, or 0 to open every port at once.
+	 * @return The per-port results and timing of the open operation.
+	 * @see #openPorts(SerialComm[],SerialComm)
+	 */
+	static public final OpenResults openPorts(SerialComm[] ports, SerialComm settings, int maxThreads)
+	{
+		if (settings != null)
+			for (int i = 0; i < ports.length; ++i)
+				if (ports[i] != null)
+					ports[i].copySettings(settings);
+		
+		OpenResults results = new OpenResults(ports);
+		long startTime = System.nanoTime();
+		results.numOpened = openPortsInParallel(ports, results.openTimes, maxThreads);
+		results.totalTime = System.nanoTime() - startTime;
+		for (int i = 0; i < ports.length; ++i)
+			results.opened[i] = (ports[i] != null) && ports[i].isOpened;
+		return results;
+	}
+	
+	/**
+	 * Enables or disables the native call trace for all serial ports in this process.
+	 * <p>
+	 * While tracing is enabled, every call into the main native port functions is recorded along with its port, primary argument,
+	 * result, <i>errno</i> value, and duration.  Each thread records into its own lock-free ring holding its most recent 4096 calls,
+	 * so tracing adds only two clock reads and a few stores to each call and never makes threads wait for each other.  Use
+	 * {@link #dumpNativeTrace(String)} to save the recorded calls for later analysis.
+	 * <p>
+	 * Native call tracing is currently only supported on Linux.
+	 * 
+	 * @param enabled Whether native calls should be recorded.
+	 */
+	static public native void setNativeTraceEnabled(boolean enabled);
+	
+	/**
+	 * Writes the most recent native calls recorded by every thread to a compact binary trace file.
+	 * <p>
+	 * Recording continues while the trace is being written.  The file can be decoded using {@link #printNativeTrace(String,boolean,PrintStream)}.
+	 * 
+	 * @param fileName The path of the trace file to create.
+	 * @return Whether the trace file was successfully written.
+	 * @see #setNativeTraceEnabled(boolean)
+	 */
+	static public native boolean dumpNativeTrace(String fileName);
+	
+	// Names of the traced native functions, in the order of their identifiers in the trace file
+	static private final String[] TRACE_FUNCTION_NAMES = { "unknown", "openPort", "closePort", "configPort", "configFlowControl", "configTimeouts",
+		"configRs485", "bytesAvailable", "readBytes", "readAvailableBytes", "writeBytes", "transmitFile", "readUntilMatch", "readIntoPooledBuffer" };
+	
+	// Identifier of the last traced function that returns a boolean, matching TRACE_LAST_BOOLEAN_FUNCTION in the native library
+	static private final int TRACE_LAST_BOOLEAN_FUNCTION = 6;
+	
 	// Parity Values
 	static final public int NO_PARITY = 0;
 	static final public int ODD_PARITY = 1;
@@ -145,9 +228,57 @@ public class SerialComm
 	static final public int TIMEOUT_READ_BLOCKING = 0x00000100;
 	static final public int TIMEOUT_WRITE_BLOCKING = 0x00001000;
 	
+	// Transaction Status Values
+	static final public int TRANSACTION_OK = 0;
+	static final public int TRANSACTION_TIMEOUT = 1;
+	static final public int TRANSACTION_MISMATCH = 2;
+	static final public int TRANSACTION_ERROR = 3;
+	
+	// Real-Time Scheduling Policies
+	static final public int SCHEDULING_DEFAULT = 0;
+	static final public int SCHEDULING_FIFO = 1;
+	static final public int SCHEDULING_ROUND_ROBIN = 2;
+	
+	// GNSS Message Types
+	static final public int GNSS_MESSAGE_UBX = 1;
+	static final public int GNSS_MESSAGE_NMEA = 2;
+	
+	// File Transfer Protocols
+	static final public int FILE_TRANSFER_RAW = 0;
+	static final public int FILE_TRANSFER_XMODEM = 1;
+	static final public int FILE_TRANSFER_XMODEM_1K = 2;
+	static final public int FILE_TRANSFER_YMODEM = 3;
+	
+	// Transmit Pacing Units
+	static final public int PACING_MICROSECONDS = 0;
+	static final public int PACING_CHARACTER_TIMES = 1;
+	
+	// Modem Control Lines
+	static final public int MODEM_LINE_CTS = 0x00000001;
+	static final public int MODEM_LINE_DSR = 0x00000002;
+	static final public int MODEM_LINE_DCD = 0x00000004;
+	static final public int MODEM_LINE_RI = 0x00000008;
+	static final public int MODEM_LINE_DTR = 0x00000010;
+	static final public int MODEM_LINE_RTS = 0x00000020;
+	
 	// Serial Port Parameters
 	private volatile int baudRate = 9600, dataBits = 8, stopBits = ONE_STOP_BIT, parity = NO_PARITY;
 	private volatile int timeoutMode = TIMEOUT_NONBLOCKING, readTimeout = 0, writeTimeout = 0, flowControl = 0;
+	private volatile int rs485DelayBefore = 0, rs485DelayAfter = 0;
+	private volatile boolean rs485Mode = false, rs485RtsActiveHigh = true, rs485RxDuringTx = false, rs485Emulated = false;
+	private volatile int realtimePolicy = SCHEDULING_DEFAULT, realtimePriority = 0, realtimeVersion = 0;
+	private volatile long realtimeCpuMask = 0l;
+	private volatile boolean realtimeLockMemory = false;
+	private volatile long fileBytesSent = 0, fileBytesTotal = 0;
+	private volatile double pacingInterByteGap = 0.0, pacingInterFrameGap = 0.0;
+	private volatile int pacingUnits = PACING_MICROSECONDS;
+	private final long[] pacingStatistics = new long[10];
+	private volatile boolean autoReconnect = false, reconnecting = false;
+	private volatile int reconnectQueueLimit = 0;
+	private volatile String deviceIdentity = null;
+	private volatile ConnectionListener connectionListener = null;
+	private volatile Thread connectionMonitor = null;
+	private final ByteArrayOutputStream reconnectQueue = new ByteArrayOutputStream();
 	private volatile SerialCommInputStream inputStream = null;
 	private volatile SerialCommOutputStream outputStream = null;
 	private volatile String portString, comPort;
@@ -163,6 +294,12 @@ public class SerialComm
 	
 	/**
 	 * Closes this serial port.
+	 * <p>
+	 * It is safe to call this method while other threads are blocked reading from or writing to the port.  Any such calls are woken up
+	 * immediately and return an error, and the underlying port is not released until the last of them has returned, so a port opened
+	 * in the meantime can never receive data intended for the closed one.
+	 * <p>
+	 * On Linux, one thread may read from the port while another thread writes to it, without either one holding up the other.
 	 */
 	public final native boolean closePort();
 	
@@ -170,6 +307,7 @@ public class SerialComm
 	private final native boolean configPort();							// Changes/sets serial port parameters as defined by this class
 	private final native boolean configFlowControl();					// Changes/sets flow control parameters as defined by this class
 	private final native boolean configTimeouts();						// Changes/sets serial port timeouts as defined by this class
+	private final native boolean configRs485();						// Changes/sets RS-485 half-duplex parameters as defined by this class
 	
 	/**
 	 * Returns the number of bytes available without blocking if {@link #readBytes} were to be called immediately
@@ -193,6 +331,8 @@ public class SerialComm
 	 * @return The number of bytes successfully read, or -1 if there was an error reading from the port.
 	 */
 	public final native int readBytes(byte[] buffer, long bytesToRead);
+	private final native int readAvailableBytes(byte[] buffer, int offset, int bytesToRead);	// Waits for any data regardless of timeout mode, then reads up to bytesToRead bytes
+	static private volatile boolean readAvailableBytesSupported = true;							// Cleared if the native library for this platform predates readAvailableBytes
 	
 	/**
 	 * Writes up to <i>bytesToWrite</i> raw data bytes from the buffer parameter to the serial port.
@@ -209,20 +349,382 @@ public class SerialComm
 	 */
 	public final native int writeBytes(byte[] buffer, long bytesToWrite);
 	
+	// Transaction Engine Methods
+	private final native int executeTransactionCycles(TransactionSchedule schedule, TransactionResults results, int numCycles);
+	
+	// Port Group Methods
+	static private native int writeBytesToPorts(SerialComm[] ports, byte[] buffer, long bytesToWrite, int[] bytesWritten, long[] writeTimes);
+	static private native int readBytesFromPorts(SerialComm[] ports, byte[] buffer, int bytesPerPort, int[] bytesRead, long[] arrivalTimes, int timeout);
+	
+	// Real-Time Thread Methods
+	private final native boolean measureWakeupLatencies(LatencyHistogram histogram, int numSamples, int interval);	// Samples timer wakeup latencies on the calling thread using this port's real-time settings
+	
+	// GNSS Parser Methods
+	static private native long createGnssParser(ByteBuffer messageBuffer, int maxMessageLength);	// Allocates native parser state decoding into the message buffer
+	static private native void destroyGnssParser(long parserState);								// Frees native parser state
+	static private native int parseGnssData(GnssParser parser, byte[] data, int offset, int length);	// Parses recorded data, returning the number of bytes consumed
+	private final native int readGnssData(GnssParser parser, int timeout);						// Reads and parses data from this port until at least one message is available
+	
+	// File Transfer Methods
+	private final native long transmitFile(String fileName, long offset, long length, int protocol);	// Sends a file region natively, returning its length or a negative error code
+	
+	// Port Broker Methods
+	static private native long createPortBroker(String brokerName, int ringSize, int writeRingSize);	// Creates the shared memory for a new broker
+	static private native long attachPortBroker(String brokerName);									// Maps the shared memory of an existing broker
+	static private native void stopPortBroker(long brokerState);									// Wakes up and stops all broker threads
+	static private native void detachPortBroker(long brokerState);									// Unmaps the shared memory, removing it if this is the owner
+	private final native int publishToBroker(long brokerState);									// Publishes data received by this port until the broker is stopped
+	private final native int transmitFromBroker(long brokerState);								// Writes data queued by broker clients to this port until the broker is stopped
+	static private native int brokerBytesAvailable(long brokerState);								// Returns the number of published bytes not yet read by a client
+	static private native int readFromBroker(PortBrokerClient client, byte[] buffer, int offset, int length, int timeout);	// Reads published data as a client
+	static private native int writeToBroker(long brokerState, byte[] buffer, int offset, int length);	// Queues data for transmission by the broker
+	
+	// Expect Methods
+	static private native long createExpectAutomaton(byte[][] patterns);							// Builds the native pattern matching automaton
+	static private native void destroyExpectAutomaton(long automatonState);						// Frees the native pattern matching automaton
+	private final native int readUntilMatch(ExpectPatterns patterns, ExpectResult result, int timeout);	// Reads from this port until a pattern is matched, returning its index, -1 on timeout, or -2 on error
+	
+	// Auto-Reconnect Methods
+	private final native boolean waitForHangup();												// Blocks until the device hangs up (closing the port) or the port is closed
+	static private native String waitForDevice(String deviceIdentity, int timeout);				// Waits for a device to reappear, returning its current device node or null on timeout
+	
+	// Receive Buffer Pool Methods
+	static private native long createReceiveBufferPool(int numBuffers, int bufferSize);			// Allocates the native slab holding every buffer of a pool
+	static private native ByteBuffer getReceiveBuffer(long poolState, int index);				// Returns a direct view of one buffer in the slab
+	static private native void destroyReceiveBufferPool(long poolState);						// Frees the native slab
+	private final native int readIntoPooledBuffer(PooledBuffer buffer, int timeout);			// Reads directly into a pooled buffer, returning the number of bytes read, 0 on timeout, or -1 on error
+	
+	// Bulk Open Methods
+	static private native int openPortsInParallel(SerialComm[] ports, long[] openTimes, int maxThreads);	// Opens and configures ports on native worker threads, returning the number opened
+	
+	// Modem Line Methods
+	private final native boolean setModemLine(int line, boolean asserted);						// Asserts or de-asserts DTR or RTS
+	private final native long createModemLineMonitor(int lineMask);							// Starts the native thread waiting for modem line changes
+	static private native void stopModemLineMonitor(long monitorState);							// Stops the native thread, waking up any reader
+	static private native void destroyModemLineMonitor(long monitorState);						// Frees the native monitor state
+	static private native int readModemLineEvents(long monitorState, long[] timestamps, int[] lineStates, int[] changedLines, int timeout);	// Returns the number of events read, 0 on timeout, or -1 once stopped
+	static private native long getNumDroppedModemLineEvents(long monitorState);					// Returns the number of events lost to a slow reader
+	
 	// Default Constructor
 	public SerialComm() {}
 	
+	/**
+	 * Executes a cyclic schedule of request/response transactions natively on this serial port.
+	 * <p>
+	 * Each cycle sends every request in the schedule in order and waits for the corresponding response or timeout before
+	 * moving on to the next request, without returning to Java until all <i>numCycles</i> cycles have completed.  The
+	 * inter-frame silent interval configured in the schedule is enforced before each request is sent.  The results of every
+	 * transaction in every cycle, along with cycle timing statistics, are returned in a single batch.
+	 * <p>
+	 * Transaction schedules are currently only supported on Linux.
+	 * 
+	 * @param schedule The schedule of transactions to execute.
+	 * @param numCycles The number of times to run through the entire schedule.
+	 * @return The results of all executed transactions.
+	 * @throws IOException If the port was closed or disconnected before all cycles completed.
+	 * @see TransactionSchedule
+	 * @see TransactionResults
+	 */
+	public final TransactionResults executeTransactions(TransactionSchedule schedule, int numCycles) throws IOException
+	{
+		TransactionResults results = new TransactionResults(schedule, numCycles);
+		results.numCompletedCycles = executeTransactionCycles(schedule, results, numCycles);
+		if ((results.numCompletedCycles < numCycles) && !isOpened)
+			throw new IOException("This port appears to have been shutdown or disconnected.");
+		return results;
+	}
+	
+	/**
+	 * Sends part of a file to this serial port without passing its contents through the Java heap.
+	 * <p>
+	 * The file is transmitted natively straight from the operating system's page cache, either using <i>sendfile()</i> if the
+	 * serial driver supports it, or by writing directly out of a memory-mapped view of the file otherwise.  Any hardware or software
+	 * flow control configured on the port is honored, since the data still passes through the driver's output queue.  This method
+	 * blocks until the last byte has physically left the port.
+	 * <p>
+	 * When one of the block-acknowledged protocols is selected ({@link #FILE_TRANSFER_XMODEM}, {@link #FILE_TRANSFER_XMODEM_1K},
+	 * {@link #FILE_TRANSFER_YMODEM}), the entire handshake is carried out natively: the transfer starts once the receiver requests
+	 * it, every block is retransmitted until it has been acknowledged, and CRC-16 or arithmetic checksums are used depending on
+	 * what the receiver asks for.  YMODEM transfers additionally send the file name and size before the data.
+	 * <p>
+	 * The progress of the transfer can be monitored from another thread using {@link #getFileTransferProgress()}.  File transfers
+	 * are currently only supported on Linux.
+	 * 
+	 * @param fileName The path of the file to send.
+	 * @param offset The position in the file of the first byte to send.
+	 * @param length The number of bytes to send, or -1 to send the remainder of the file.
+	 * @param protocol The file transfer protocol to use.
+	 * @return The number of bytes that were sent.
+	 * @throws IOException If the file could not be read, the receiver never requested the transfer, the receiver cancelled or stopped acknowledging the transfer, or the port was closed or disconnected.
+	 * @see #FILE_TRANSFER_RAW
+	 * @see #FILE_TRANSFER_XMODEM
+	 * @see #FILE_TRANSFER_XMODEM_1K
+	 * @see #FILE_TRANSFER_YMODEM
+	 */
+	public final long sendFile(String fileName, long offset, long length, int protocol) throws IOException
+	{
+		long bytesSent = transmitFile(fileName, offset, length, protocol);
+		if (bytesSent == -3)
+			throw new IOException("Unable to read the file " + fileName + ".");
+		else if (bytesSent == -1)
+			throw new IOException("The receiver did not request the file transfer in time.");
+		else if (bytesSent == -4)
+			throw new IOException("The file transfer was cancelled or not acknowledged by the receiver.");
+		else if (bytesSent < 0)
+			throw new IOException("This port appears to have been shutdown or disconnected.");
+		return bytesSent;
+	}
+	
+	/**
+	 * Sends part of a file to this serial port as raw data without passing its contents through the Java heap.
+	 * 
+	 * @param fileName The path of the file to send.
+	 * @param offset The position in the file of the first byte to send.
+	 * @param length The number of bytes to send, or -1 to send the remainder of the file.
+	 * @return The number of bytes that were sent.
+	 * @throws IOException If the file could not be read or the port was closed or disconnected.
+	 * @see #sendFile(String,long,long,int)
+	 */
+	public final long sendFile(String fileName, long offset, long length) throws IOException { return sendFile(fileName, offset, length, FILE_TRANSFER_RAW); }
+	
+	/**
+	 * Returns the number of file bytes sent so far by the current or most recent call to {@link #sendFile(String,long,long,int)}.
+	 * <p>
+	 * For raw transfers, this only counts bytes that have already left the driver's output queue.  For block-acknowledged
+	 * transfers, it only counts bytes in blocks that have been acknowledged by the receiver.
+	 * 
+	 * @return The number of bytes transferred.
+	 */
+	public final long getFileTransferProgress() { return fileBytesSent; }
+	
+	/**
+	 * Returns the total number of bytes to be sent by the current or most recent call to {@link #sendFile(String,long,long,int)}.
+	 * 
+	 * @return The length of the file transfer.
+	 */
+	public final long getFileTransferLength() { return fileBytesTotal; }
+	
+	/**
+	 * Reads from this serial port until one of the specified patterns has been received or the timeout expires.
+	 * <p>
+	 * Every received byte is fed natively through the precompiled pattern automaton exactly once as it arrives, so waiting for any
+	 * one of several responses takes time proportional to the amount of data received, regardless of how many patterns there are.
+	 * The port is never read past the end of the first match, so any data following it remains available to the next read.
+	 * <p>
+	 * Expect operations are currently only supported on Linux.
+	 * 
+	 * @param patterns The precompiled set of patterns to wait for.
+	 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+	 * @return The index of the pattern that was matched, along with all of the data consumed up to and including the match.
+	 * @throws IOException If the port was closed or disconnected.
+	 * @see ExpectPatterns
+	 */
+	public final ExpectResult expect(ExpectPatterns patterns, int timeout) throws IOException
+	{
+		ExpectResult result = new ExpectResult();
+		if ((patterns.automatonState == 0) || ((result.patternIndex = readUntilMatch(patterns, result, timeout)) == -2))
+			throw new IOException("This port appears to have been shutdown or disconnected.");
+		return result;
+	}
+	
+	/**
+	 * Reads from this serial port until one of the specified patterns has been received or the timeout expires.
+	 * <p>
+	 * The patterns are compiled anew on every call, so an {@link ExpectPatterns} object should be used instead when waiting for the
+	 * same set of responses repeatedly.
+	 * 
+	 * @param patterns The patterns to wait for, each character of which is matched as a single byte.
+	 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+	 * @return The index of the pattern that was matched, along with all of the data consumed up to and including the match.
+	 * @throws IOException If the port was closed or disconnected.
+	 * @see #expect(ExpectPatterns,int)
+	 */
+	public final ExpectResult expect(String[] patterns, int timeout) throws IOException
+	{
+		ExpectPatterns compiledPatterns = new ExpectPatterns(patterns);
+		try { return expect(compiledPatterns, timeout); }
+		finally { compiledPatterns.close(); }
+	}
+	
+	/**
+	 * Enables or disables automatic reconnection of this serial port after its device is unplugged or otherwise hangs up.
+	 * <p>
+	 * When enabled, a background thread watches the open port for a hangup, so a disconnect is noticed immediately even if no
+	 * thread is currently reading or writing.  The port is then closed and the device is waited for using file system change
+	 * notifications on its most stable name (its USB serial number link in <i>/dev/serial/by-id</i> if it has one, otherwise its
+	 * bus location link in <i>/dev/serial/by-path</i>), so it is found again even if it reappears under a different device node.
+	 * As soon as it is accessible, the port is reopened with all of its current settings.
+	 * <p>
+	 * Data written while the port is disconnected, either directly or through {@link #getOutputStream()}, including any write that
+	 * failed because of the disconnect, is queued in full and sent in order after reconnecting, ahead of any newer writes.  Once the queue holds <i>maxQueuedBytes</i> bytes, further writes
+	 * fail.  Reads fail as usual while the port is disconnected.  Closing the port with {@link #closePort()} stops any reconnect
+	 * attempt in progress.
+	 * <p>
+	 * Automatic reconnection is currently only supported on Linux.
+	 * 
+	 * @param enabled Whether the port should be reconnected automatically.
+	 * @param maxQueuedBytes The maximum number of bytes to keep for transmission while disconnected.
+	 * @see #setConnectionListener(ConnectionListener)
+	 */
+	public final void setAutoReconnect(boolean enabled, int maxQueuedBytes)
+	{
+		synchronized (reconnectQueue)
+		{
+			reconnectQueueLimit = maxQueuedBytes;
+			autoReconnect = enabled;
+			if (!enabled)
+			{
+				reconnecting = false;
+				reconnectQueue.reset();
+			}
+		}
+		if (enabled && isOpened)
+			startConnectionMonitor();
+	}
+	
+	/**
+	 * Registers a listener to be notified whenever this port is disconnected or automatically reconnected.
+	 * <p>
+	 * The listener is called from the port's connection monitoring thread while automatic reconnection is enabled.  Any data
+	 * written from within {@link ConnectionListener#portReconnected(SerialComm)} is sent after the data queued while disconnected.
+	 * 
+	 * @param listener The listener to notify, or null to remove the current listener.
+	 * @see #setAutoReconnect(boolean,int)
+	 */
+	public final void setConnectionListener(ConnectionListener listener) { connectionListener = listener; }
+	
+	/**
+	 * Returns whether this port is currently disconnected and waiting to be reconnected automatically.
+	 * 
+	 * @return Whether a reconnect is in progress.
+	 */
+	public final boolean isReconnecting() { return reconnecting; }
+	
+	/**
+	 * Returns the stable device name used to find this port again after it has been disconnected.
+	 * 
+	 * @return The device link or node recorded when the port was last opened, or null if it has never been opened.
+	 */
+	public final String getDeviceIdentity() { return deviceIdentity; }
+	
+	// Called natively when a write is attempted while reconnecting, returning the number of bytes queued, -1 if the queue is full, or -2 to write directly
+	private final int queueForReconnect(byte[] buffer, long length)
+	{
+		synchronized (reconnectQueue)
+		{
+			if (!reconnecting || (Thread.currentThread() == connectionMonitor))
+				return -2;
+			else if ((reconnectQueue.size() + length) > reconnectQueueLimit)
+				return -1;
+			reconnectQueue.write(buffer, 0, (int)length);
+			return (int)length;
+		}
+	}
+	
+	// Called natively whenever the port is opened with automatic reconnection enabled
+	private final synchronized void startConnectionMonitor()
+	{
+		if (connectionMonitor != null)
+			return;
+		connectionMonitor = new Thread(new Runnable() { public void run() { monitorConnection(); } }, "SerialComm-" + getSystemPortName() + "-monitor");
+		connectionMonitor.setDaemon(true);
+		connectionMonitor.start();
+	}
+	
+	private final void monitorConnection()
+	{
+		while (true)
+		{
+			// Stop monitoring once the port has been closed by the user or automatic reconnection has been disabled
+			synchronized (this)
+			{
+				if (!autoReconnect || (!isOpened && !reconnecting))
+				{
+					connectionMonitor = null;
+					return;
+				}
+			}
+			if (!reconnecting)
+			{
+				// A port that is still open after the wait neither hung up nor was closed, so hangups cannot be detected on this platform
+				long monitoredHandle = portHandle;
+				if (!waitForHangup() && isOpened && (portHandle == monitoredHandle))
+				{
+					synchronized (this) { connectionMonitor = null; }
+					return;
+				}
+				continue;
+			}
+			ConnectionListener listener = connectionListener;
+			if (listener != null)
+				listener.portDisconnected(this);
+			
+			// Reopen the port as soon as its device reappears
+			boolean reopened = false;
+			while (!reopened && reconnecting && autoReconnect)
+			{
+				String devicePath = waitForDevice(deviceIdentity, 500);
+				if ((devicePath != null) && reconnecting)
+				{
+					comPort = devicePath;
+					if (!(reopened = openPort()))
+						try { Thread.sleep(100); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+				}
+			}
+			if (!reopened)
+				continue;
+			else if (!reconnecting)
+			{
+				closePort();
+				continue;
+			}
+			listener = connectionListener;
+			if (listener != null)
+				listener.portReconnected(this);
+			
+			// Send everything that was queued while disconnected before letting new writes through directly
+			while (true)
+			{
+				byte[] queuedData;
+				synchronized (reconnectQueue)
+				{
+					if (reconnectQueue.size() == 0)
+					{
+						reconnecting = false;
+						break;
+					}
+					queuedData = reconnectQueue.toByteArray();
+					reconnectQueue.reset();
+				}
+				if (writeBytes(queuedData, queuedData.length) < 0)
+				{
+					// Put the data back in front of anything queued in the meantime if the port failed again
+					synchronized (reconnectQueue)
+					{
+						byte[] newerData = reconnectQueue.toByteArray();
+						reconnectQueue.reset();
+						reconnectQueue.write(queuedData, 0, queuedData.length);
+						reconnectQueue.write(newerData, 0, newerData.length);
+					}
+					break;
+				}
+			}
+		}
+	}
+	
 	/**
 	 * Returns an {@link java.io.InputStream} object associated with this serial port.
 	 * <p>
 	 * Allows for easier read access of the underlying data stream and abstracts away many low-level read details.
+	 * The returned stream is internally buffered and blocks efficiently while waiting for data, regardless of the
+	 * timeout mode configured using {@link #setComPortTimeouts(int,int,int)}.
 	 * <p>
 	 * Make sure to call the {@link java.io.InputStream#close()} method when you are done using this stream.
 	 * 
 	 * @return An {@link java.io.InputStream} object associated with this serial port.
 	 * @see java.io.InputStream
 	 */
-	public final InputStream getInputStream()
+	public final SerialCommInputStream getInputStream()
 	{
 		if ((inputStream == null) && isOpened)
 			inputStream = new SerialCommInputStream();
@@ -401,6 +903,203 @@ public class SerialComm
 	 */
 	public final void setParity(int newParity) { parity = newParity; configPort(); }
 	
+	/**
+	 * Enables or disables RS-485 half-duplex mode for this serial port.
+	 * <p>
+	 * In RS-485 mode, the RTS line is used to enable the bus transmitter for the duration of each {@link #writeBytes(byte[],long)}
+	 * call.  Whenever the serial driver supports it, transmitter control is handed to the operating system so that the bus is
+	 * released as soon as the last stop bit has left the port.  Otherwise, RTS is toggled natively around each write, and the
+	 * transmitter is only released after the output queue and the UART shift register have both been drained.
+	 * <p>
+	 * The delay parameters specify how long to keep the transmitter enabled before the first start bit and after the last
+	 * stop bit, respectively.  Note that drivers which support RS-485 mode only allow for millisecond delay resolution, so
+	 * these values are rounded up to the nearest millisecond in that case.
+	 * <p>
+	 * RS-485 mode is currently only supported on Linux.
+	 * 
+	 * @param useRS485Mode Whether to enable RS-485 half-duplex mode.
+	 * @param rtsActiveHigh Whether RTS should be asserted (true) or de-asserted (false) while transmitting.
+	 * @param delayBeforeSendMicroseconds The number of microseconds to wait after enabling the transmitter before sending data.
+	 * @param delayAfterSendMicroseconds The number of microseconds to wait after the last stop bit before disabling the transmitter.
+	 * @param receiveDuringTransmit Whether data received while transmitting (such as a local echo) should be kept.
+	 */
+	public final void setRs485ModeParameters(boolean useRS485Mode, boolean rtsActiveHigh, int delayBeforeSendMicroseconds, int delayAfterSendMicroseconds, boolean receiveDuringTransmit)
+	{
+		rs485Mode = useRS485Mode;
+		rs485RtsActiveHigh = rtsActiveHigh;
+		rs485DelayBefore = delayBeforeSendMicroseconds;
+		rs485DelayAfter = delayAfterSendMicroseconds;
+		rs485RxDuringTx = receiveDuringTransmit;
+		configRs485();
+	}
+	
+	// Copies the port parameters, flow control, timeouts, and RS-485 settings of another port without applying them
+	private final void copySettings(SerialComm settings)
+	{
+		baudRate = settings.baudRate;
+		dataBits = settings.dataBits;
+		stopBits = settings.stopBits;
+		parity = settings.parity;
+		flowControl = settings.flowControl;
+		timeoutMode = settings.timeoutMode;
+		readTimeout = settings.readTimeout;
+		writeTimeout = settings.writeTimeout;
+		rs485Mode = settings.rs485Mode;
+		rs485RtsActiveHigh = settings.rs485RtsActiveHigh;
+		rs485DelayBefore = settings.rs485DelayBefore;
+		rs485DelayAfter = settings.rs485DelayAfter;
+		rs485RxDuringTx = settings.rs485RxDuringTx;
+	}
+	
+	/**
+	 * Returns the current states of the modem control lines.
+	 * <p>
+	 * Reading the modem control lines is currently only supported on Linux.
+	 * 
+	 * @return A bitmask of the asserted lines, or -1 if the port is closed or the lines cannot be read.
+	 * @see #MODEM_LINE_CTS
+	 * @see #MODEM_LINE_DSR
+	 * @see #MODEM_LINE_DCD
+	 * @see #MODEM_LINE_RI
+	 * @see #MODEM_LINE_DTR
+	 * @see #MODEM_LINE_RTS
+	 */
+	public final native int getModemLines();
+	
+	/**
+	 * Asserts or de-asserts the DTR line of this serial port.
+	 * <p>
+	 * Setting the modem control lines directly is currently only supported on Linux.
+	 * 
+	 * @param asserted Whether the line should be asserted.
+	 * @return Whether the line was successfully set.
+	 */
+	public final boolean setDTR(boolean asserted) { return setModemLine(MODEM_LINE_DTR, asserted); }
+	
+	/**
+	 * Asserts or de-asserts the RTS line of this serial port.
+	 * <p>
+	 * Note that RTS is also driven by the operating system when hardware flow control is enabled, and by the RS-485 transmitter
+	 * control described in {@link #setRs485ModeParameters(boolean,boolean,int,int,boolean)}.  Setting the modem control lines
+	 * directly is currently only supported on Linux.
+	 * 
+	 * @param asserted Whether the line should be asserted.
+	 * @return Whether the line was successfully set.
+	 */
+	public final boolean setRTS(boolean asserted) { return setModemLine(MODEM_LINE_RTS, asserted); }
+	
+	/**
+	 * Specifies the CPU affinity, scheduling policy, and memory locking settings for threads performing I/O on this port.
+	 * <p>
+	 * All reads and writes on a serial port are carried out by the thread calling the corresponding method, and the scheduling of
+	 * application threads is never changed implicitly.  To apply these settings to the calling thread and check whether they took
+	 * effect, call {@link #applyRealtimeParameters()}; the settings then remain in effect for that thread until changed.  The
+	 * service threads started by a {@link PortBroker} on this port apply them automatically.
+	 * <p>
+	 * The CPU mask selects which of the first 64 CPUs the thread may run on, with bit <i>n</i> representing CPU <i>n</i>.  A mask of 0
+	 * leaves the thread's existing CPU affinity unchanged.  The built-in scheduling policy constants should be used ({@link #SCHEDULING_DEFAULT},
+	 * {@link #SCHEDULING_FIFO}, {@link #SCHEDULING_ROUND_ROBIN}), and the priority is clamped to the range supported by the policy.
+	 * With {@link #SCHEDULING_DEFAULT}, the thread's existing policy (for example, a batch or idle policy) is left unchanged.
+	 * Real-time policies usually require elevated privileges or an appropriate <i>RLIMIT_RTPRIO</i> setting.
+	 * <p>
+	 * If memory locking is enabled, the part of the thread's stack used for temporary native I/O buffers is pre-faulted and locked
+	 * into RAM, so that no page faults occur while servicing the port.  The native buffers of every {@link PortBroker},
+	 * {@link PortBrokerClient}, {@link ReceiveBufferPool}, and {@link GnssParser} in this process are locked as well, including those
+	 * created afterwards.  The rest of the Java heap is not locked.
+	 * <p>
+	 * Real-time thread settings are currently only supported on Linux.
+	 * 
+	 * @param cpuMask The set of CPUs the I/O thread may run on, or 0 to leave its affinity unchanged.
+	 * @param schedulingPolicy The scheduling policy to use for the I/O thread.
+	 * @param priority The real-time priority to use with {@link #SCHEDULING_FIFO} or {@link #SCHEDULING_ROUND_ROBIN}.
+	 * @param lockMemory Whether to pre-fault and lock the thread's stack and the library's native buffers into memory.
+	 * @see #SCHEDULING_DEFAULT
+	 * @see #SCHEDULING_FIFO
+	 * @see #SCHEDULING_ROUND_ROBIN
+	 */
+	public final void setRealtimeParameters(long cpuMask, int schedulingPolicy, int priority, boolean lockMemory)
+	{
+		realtimeCpuMask = cpuMask;
+		realtimePolicy = schedulingPolicy;
+		realtimePriority = priority;
+		realtimeLockMemory = lockMemory;
+		++realtimeVersion;
+	}
+	
+	/**
+	 * Immediately applies the real-time settings of this port to the calling thread.
+	 * 
+	 * @return Whether all of the settings were successfully applied.
+	 * @see #setRealtimeParameters(long,int,int,boolean)
+	 */
+	public final native boolean applyRealtimeParameters();
+	
+	/**
+	 * Measures the wakeup latency of the calling thread after applying the real-time settings of this port to it.
+	 * <p>
+	 * The thread repeatedly sleeps until an absolute deadline on the monotonic clock, and the amount by which each wakeup overshot its
+	 * deadline is recorded in a histogram.  Running this method while the system is under load is a good way to verify that the
+	 * chosen CPU affinity and scheduling policy provide the required response time.  The thread's original settings are restored
+	 * once the measurement has finished.
+	 * 
+	 * @param numSamples The number of wakeups to measure.
+	 * @param intervalMicroseconds The number of microseconds between consecutive wakeups.
+	 * @return A histogram of the measured wakeup latencies.
+	 * @see #setRealtimeParameters(long,int,int,boolean)
+	 */
+	public final LatencyHistogram measureWakeupLatency(int numSamples, int intervalMicroseconds)
+	{
+		LatencyHistogram histogram = new LatencyHistogram();
+		histogram.realtimeApplied = measureWakeupLatencies(histogram, numSamples, intervalMicroseconds);
+		return histogram;
+	}
+	
+	/**
+	 * Specifies the minimum idle line time to enforce between consecutive characters and between consecutive writes to this port.
+	 * <p>
+	 * Some devices cannot keep up with back-to-back characters or require a minimum silent interval to detect the end of a frame.
+	 * When an inter-byte gap is set, every call to {@link #writeBytes(byte[],long)} hands the data to the driver one character at a
+	 * time, each one scheduled on a high-resolution timer to start the requested amount of time after the previous character has
+	 * finished transmitting.  When an inter-frame gap is set, the start of each write is delayed until the requested amount of time
+	 * has passed since the last stop bit of the previous write.  Gaps can be specified either in microseconds or in character times
+	 * at the current port settings ({@link #PACING_MICROSECONDS}, {@link #PACING_CHARACTER_TIMES}).  Setting both gaps to 0 disables
+	 * pacing.
+	 * <p>
+	 * The gaps that were actually achieved are measured on every paced write and can be retrieved using
+	 * {@link #getTransmitPacingStatistics()}.  Transmit pacing is currently only supported on Linux.
+	 * 
+	 * @param interByteGap The idle time between the end of one character and the start of the next, or 0 to send characters back-to-back.
+	 * @param interFrameGap The idle time between the end of one write and the start of the next, or 0 for no minimum.
+	 * @param units The units in which both gaps are specified.
+	 * @see #PACING_MICROSECONDS
+	 * @see #PACING_CHARACTER_TIMES
+	 */
+	public final void setTransmitPacing(double interByteGap, double interFrameGap, int units)
+	{
+		pacingUnits = units;
+		pacingInterByteGap = interByteGap;
+		pacingInterFrameGap = interFrameGap;
+	}
+	
+	/**
+	 * Returns the requested and achieved transmit gaps measured over all paced writes since the statistics were last reset.
+	 * 
+	 * @return A snapshot of the transmit pacing statistics.
+	 * @see #setTransmitPacing(double,double,int)
+	 */
+	public final PacingStatistics getTransmitPacingStatistics()
+	{
+		synchronized (pacingStatistics) { return new PacingStatistics((long[])pacingStatistics.clone()); }
+	}
+	
+	/**
+	 * Clears all measured transmit pacing statistics.
+	 */
+	public final void resetTransmitPacingStatistics()
+	{
+		synchronized (pacingStatistics) { Arrays.fill(pacingStatistics, 0l); }
+	}
+	
 	/**
 	 * Gets a descriptive string representing this serial port or the device connected to it.
 	 * <p>
@@ -510,10 +1209,78 @@ public class SerialComm
 	 */
 	public final int getFlowControlSettings() { return flowControl; }
 	
-	// InputStream interface class
-	private final class SerialCommInputStream extends InputStream
+	/**
+	 * Returns whether RS-485 half-duplex mode is enabled on this serial port.
+	 * 
+	 * @return Whether RS-485 mode is enabled.
+	 * @see #setRs485ModeParameters(boolean,boolean,int,int,boolean)
+	 */
+	public final boolean isRs485ModeEnabled() { return rs485Mode; }
+	
+	/**
+	 * Returns whether RS-485 transmitter control is being emulated by toggling RTS around each write, which is the case when the
+	 * underlying serial driver does not support RS-485 mode.
+	 * 
+	 * @return Whether RS-485 transmitter control is being emulated.
+	 * @see #setRs485ModeParameters(boolean,boolean,int,int,boolean)
+	 */
+	public final boolean isRs485ModeEmulated() { return rs485Emulated; }
+	
+	/**
+	 * Buffered {@link java.io.InputStream} implementation associated with a serial port.
+	 * <p>
+	 * Incoming data is read natively in blocks into an internal buffer, so single-byte reads do not require a native call
+	 * and there is no need to wrap this stream in a {@link java.io.BufferedInputStream}.  All reads wait efficiently inside
+	 * the operating system for new data to arrive, regardless of the timeout mode configured for the port.  If the native
+	 * library for the current platform does not provide this wait, the stream instead reads the port using its configured
+	 * timeouts, which busy-waits in the {@link #TIMEOUT_NONBLOCKING} mode.
+	 * 
+	 * @see java.io.InputStream
+	 */
+	public final class SerialCommInputStream extends InputStream
 	{
-		public SerialCommInputStream() {}
+		private final byte[] streamBuffer = new byte[4096];
+		private int bufferPosition = 0, bufferLength = 0;
+		
+		private SerialCommInputStream() {}
+		
+		// Blocks until at least one byte has been received and reads up to len bytes, returning -1 if the port was closed
+		private final int receive(byte[] b, int off, int len)
+		{
+			if (readAvailableBytesSupported)
+			{
+				try { return readAvailableBytes(b, off, len); }
+				catch (UnsatisfiedLinkError e) { readAvailableBytesSupported = false; }
+			}
+			
+			// Without the native wait, poll using plain reads that never ask for more than is already available
+			byte[] buffer = (off == 0) ? b : new byte[len];
+			while (isOpened)
+			{
+				int numAvailable = bytesAvailable();
+				int numRead = readBytes(buffer, (numAvailable <= 0) ? 1 : (numAvailable < len) ? numAvailable : len);
+				if (numRead < 0)
+					break;
+				else if (numRead > 0)
+				{
+					if (buffer != b)
+						System.arraycopy(buffer, 0, b, off, numRead);
+					return numRead;
+				}
+			}
+			return -1;
+		}
+		
+		// Refills the internal buffer, blocking until at least one byte has been received
+		private final void fillBuffer() throws IOException
+		{
+			bufferPosition = 0;
+			bufferLength = 0;
+			int numRead = receive(streamBuffer, 0, streamBuffer.length);
+			if (numRead < 0)
+				throw new IOException("This port appears to have been shutdown or disconnected.");
+			bufferLength = numRead;
+		}
 		
 		@Override
 		public final int available() throws IOException
@@ -521,58 +1288,112 @@ public class SerialComm
 			if (!isOpened)
 				throw new IOException("This port appears to have been shutdown or disconnected.");
 			
-			return bytesAvailable();
+			return (bufferLength - bufferPosition) + bytesAvailable();
 		}
 		
 		@Override
 		public final int read() throws IOException
 		{
-			byte[] buffer = new byte[1];
-			int bytesRead;
+			if (bufferPosition == bufferLength)
+				fillBuffer();
 			
-			while (isOpened)
-			{
-				bytesRead = readBytes(buffer, 1l);
-				if (bytesRead > 0)
-					return ((int)buffer[0] & 0x000000FF);
-			}
-			throw new IOException("This port appears to have been shutdown or disconnected.");
+			return ((int)streamBuffer[bufferPosition++] & 0x000000FF);
 		}
 		
 		@Override
 		public final int read(byte[] b) throws IOException
 		{
-			if (!isOpened)
-				throw new IOException("This port appears to have been shutdown or disconnected.");
-			
 			return read(b, 0, b.length);
-			
 		}
 		
 		@Override
 		public final int read(byte[] b, int off, int len) throws IOException
 		{
-			if (!isOpened)
-				throw new IOException("This port appears to have been shutdown or disconnected.");
+			if ((off < 0) || (len < 0) || (len > b.length - off))
+				throw new IndexOutOfBoundsException();
 			if (len == 0)
 				return 0;
 			
-			byte[] buffer = new byte[len];
-			int numRead = readBytes(buffer, len);
-			if (numRead > 0)
-				System.arraycopy(buffer, 0, b, off, numRead);
+			// Serve buffered data first
+			int numBuffered = bufferLength - bufferPosition;
+			if (numBuffered > 0)
+			{
+				int numCopied = (len < numBuffered) ? len : numBuffered;
+				System.arraycopy(streamBuffer, bufferPosition, b, off, numCopied);
+				bufferPosition += numCopied;
+				return numCopied;
+			}
 			
-			return numRead;
-		}
+			// Large reads bypass the internal buffer, receiving up to one buffer's worth of data directly into the caller's array
+			if (len >= streamBuffer.length)
+			{
+				int numRead = receive(b, off, len);
+				if (numRead < 0)
+					throw new IOException("This port appears to have been shutdown or disconnected.");
+				return numRead;
+			}
+			
+			fillBuffer();
+			return read(b, off, len);
+		}
+		
+		/**
+		 * Reads exactly <i>len</i> bytes from the serial port into the specified buffer, blocking until all requested data has
+		 * been received.
+		 * 
+		 * @param b The buffer into which the data is read.
+		 * @param off The starting offset in the buffer at which the data is written.
+		 * @param len The number of bytes to read.
+		 * @throws IOException If the port is closed or disconnected before all <i>len</i> bytes were read.
+		 */
+		public final void readFully(byte[] b, int off, int len) throws IOException
+		{
+			readNBytes(b, off, len);
+		}
+		
+		/**
+		 * Reads <i>len</i> bytes from the serial port into the specified buffer, blocking until all requested data has been received.
+		 * <p>
+		 * A serial port has no end of stream, so unlike other streams, this method never returns fewer than <i>len</i> bytes.  If the
+		 * port is closed or disconnected first, the exception is thrown just as in {@link #readFully(byte[],int,int)}, and any data
+		 * that was already received is left in the buffer.
+		 * 
+		 * @param b The buffer into which the data is read.
+		 * @param off The starting offset in the buffer at which the data is written.
+		 * @param len The number of bytes to read.
+		 * @return The number of bytes read, which is always <i>len</i>.
+		 * @throws IOException If the port is closed or disconnected before all <i>len</i> bytes were read.
+		 */
+		public final int readNBytes(byte[] b, int off, int len) throws IOException
+		{
+			if ((off < 0) || (len < 0) || (len > b.length - off))
+				throw new IndexOutOfBoundsException();
+			
+			int numRead = 0;
+			while (numRead < len)
+				numRead += read(b, off + numRead, len - numRead);
+			return numRead;
+		}
 		
 		@Override
 		public final long skip(long n) throws IOException
 		{
-			if (!isOpened)
-				throw new IOException("This port appears to have been shutdown or disconnected.");
+			if (n <= 0)
+				return 0;
 			
-			byte[] buffer = new byte[(int)n];
-			return readBytes(buffer, n);
+			// Discard data through the internal buffer, only blocking if nothing has been received yet
+			long numSkipped = 0;
+			do
+			{
+				if (bufferPosition == bufferLength)
+					fillBuffer();
+				int numDiscarded = bufferLength - bufferPosition;
+				if ((n - numSkipped) < numDiscarded)
+					numDiscarded = (int)(n - numSkipped);
+				bufferPosition += numDiscarded;
+				numSkipped += numDiscarded;
+			} while ((numSkipped < n) && (bytesAvailable() > 0));
+			return numSkipped;
 		}
 	}
 	
@@ -581,10 +1402,12 @@ public class SerialComm
 	{
 		public SerialCommOutputStream() {}
 		
+		// Writes made while the port is being reconnected are passed through so that they can be queued natively
+		
 		@Override
 		public final void write(int b) throws IOException
 		{
-			if (!isOpened)
+			if (!isOpened && !reconnecting)
 				throw new IOException("This port appears to have been shutdown or disconnected.");
 			
 			byte[] buffer = new byte[1];
@@ -596,7 +1419,7 @@ public class SerialComm
 		@Override
 		public final void write(byte[] b) throws IOException
 		{
-			if (!isOpened)
+			if (!isOpened && !reconnecting)
 				throw new IOException("This port appears to have been shutdown or disconnected.");
 			
 			write(b, 0, b.length);
@@ -605,7 +1428,7 @@ public class SerialComm
 		@Override
 		public final void write(byte[] b, int off, int len) throws IOException
 		{
-			if (!isOpened)
+			if (!isOpened && !reconnecting)
 				throw new IOException("This port appears to have been shutdown or disconnected.");
 			
 			byte[] buffer = new byte[len];
@@ -615,6 +1438,1660 @@ public class SerialComm
 		}
 	}
 	
+	/**
+	 * Represents a cyclic schedule of request/response transactions to be executed using {@link SerialComm#executeTransactions}.
+	 * <p>
+	 * A response is considered complete once its expected length has been received or, if no expected length is specified,
+	 * once the bus has been silent for the inter-frame gap after the first byte was received.  A response whose first bytes do
+	 * not match the expected response prefix is reported as {@link SerialComm#TRANSACTION_MISMATCH}.
+	 * <p>
+	 * By default, the inter-frame gap is 3.5 character times at the current port settings, as required by Modbus RTU, and
+	 * each cycle starts immediately after the previous one has completed.
+	 */
+	static public final class TransactionSchedule
+	{
+		private byte[] requestData = new byte[0], prefixData = new byte[0];
+		private int[] requestOffsets = { 0 }, prefixOffsets = { 0 }, responseOffsets = { 0 };
+		private int[] expectedLengths = new int[0], timeouts = new int[0];
+		private int numTransactions = 0, interFrameGap = 0, cyclePeriod = 0;
+		
+		/**
+		 * Creates a new, empty transaction schedule.
+		 */
+		public TransactionSchedule() {}
+		
+		/**
+		 * Appends a transaction to the end of this schedule.
+		 * 
+		 * @param request The raw request data to transmit.
+		 * @param expectedResponsePrefix The bytes that a valid response must start with, or null to accept any response.
+		 * @param expectedResponseLength The exact length of a complete response, or 0 if responses are delimited by bus silence.
+		 * @param maxResponseLength The maximum number of response bytes to store.
+		 * @param timeout The number of milliseconds to wait for a complete response after the request has been transmitted.
+		 * @return The index of the new transaction within this schedule.
+		 */
+		public final int addTransaction(byte[] request, byte[] expectedResponsePrefix, int expectedResponseLength, int maxResponseLength, int timeout)
+		{
+			if (expectedResponsePrefix == null)
+				expectedResponsePrefix = new byte[0];
+			if (maxResponseLength < expectedResponseLength)
+				maxResponseLength = expectedResponseLength;
+			
+			requestData = appendBytes(requestData, request);
+			prefixData = appendBytes(prefixData, expectedResponsePrefix);
+			requestOffsets = appendInt(requestOffsets, requestData.length);
+			prefixOffsets = appendInt(prefixOffsets, prefixData.length);
+			responseOffsets = appendInt(responseOffsets, responseOffsets[numTransactions] + maxResponseLength);
+			expectedLengths = appendInt(expectedLengths, expectedResponseLength);
+			timeouts = appendInt(timeouts, timeout);
+			return numTransactions++;
+		}
+		
+		/**
+		 * Returns the number of transactions in this schedule.
+		 * 
+		 * @return The number of transactions in one cycle of this schedule.
+		 */
+		public final int getNumTransactions() { return numTransactions; }
+		
+		/**
+		 * Sets the minimum period of bus silence to enforce before transmitting each request, which also delimits responses
+		 * that have no expected length.
+		 * 
+		 * @param microseconds The inter-frame gap in microseconds, or 0 to use 3.5 character times at the current port settings.
+		 */
+		public final void setInterFrameGap(int microseconds) { interFrameGap = microseconds; }
+		
+		/**
+		 * Sets a fixed period at which consecutive cycles are started.
+		 * 
+		 * @param microseconds The cycle period in microseconds, or 0 to start each cycle as soon as the previous one completes.
+		 */
+		public final void setCyclePeriod(int microseconds) { cyclePeriod = microseconds; }
+		
+		private static byte[] appendBytes(byte[] array, byte[] values)
+		{
+			byte[] newArray = new byte[array.length + values.length];
+			System.arraycopy(array, 0, newArray, 0, array.length);
+			System.arraycopy(values, 0, newArray, array.length, values.length);
+			return newArray;
+		}
+		
+		private static int[] appendInt(int[] array, int value)
+		{
+			int[] newArray = new int[array.length + 1];
+			System.arraycopy(array, 0, newArray, 0, array.length);
+			newArray[array.length] = value;
+			return newArray;
+		}
+	}
+	
+	/**
+	 * Contains the results of all transactions executed by a call to {@link SerialComm#executeTransactions}.
+	 * <p>
+	 * All times are reported in nanoseconds.  The response time of a transaction is measured from the start of the request
+	 * transmission until the last response byte was received.  Cycle jitter is measured as the largest deviation of a cycle's
+	 * start time from its schedule if a cycle period was configured, or as the difference between the longest and shortest
+	 * cycle times otherwise.
+	 */
+	static public final class TransactionResults
+	{
+		private final int numTransactions, numCycles, responseSize, cyclePeriod;
+		private final int[] responseOffsets, responseLengths, statuses;
+		private final long[] responseTimes, cycleStartTimes, cycleDurations;
+		private final byte[] responseData;
+		private int numCompletedCycles = 0;
+		
+		private TransactionResults(TransactionSchedule schedule, int numScheduledCycles)
+		{
+			numTransactions = schedule.numTransactions;
+			numCycles = numScheduledCycles;
+			responseOffsets = schedule.responseOffsets;
+			responseSize = responseOffsets[numTransactions];
+			cyclePeriod = schedule.cyclePeriod;
+			responseData = new byte[numCycles * responseSize];
+			responseLengths = new int[numCycles * numTransactions];
+			statuses = new int[numCycles * numTransactions];
+			responseTimes = new long[numCycles * numTransactions];
+			cycleStartTimes = new long[numCycles];
+			cycleDurations = new long[numCycles];
+		}
+		
+		/**
+		 * Returns the number of cycles that were executed to completion.
+		 * 
+		 * @return The number of completed cycles.
+		 */
+		public final int getNumCycles() { return numCompletedCycles; }
+		
+		/**
+		 * Returns the status of the specified transaction, which should be compared with the built-in transaction status
+		 * constants ({@link SerialComm#TRANSACTION_OK}, {@link SerialComm#TRANSACTION_TIMEOUT}, {@link SerialComm#TRANSACTION_MISMATCH},
+		 * {@link SerialComm#TRANSACTION_ERROR}).
+		 * 
+		 * @param cycle The index of the cycle.
+		 * @param transaction The index of the transaction within the schedule.
+		 * @return The status of the transaction.
+		 */
+		public final int getStatus(int cycle, int transaction) { return statuses[(cycle * numTransactions) + transaction]; }
+		
+		/**
+		 * Returns the raw response data received for the specified transaction.
+		 * 
+		 * @param cycle The index of the cycle.
+		 * @param transaction The index of the transaction within the schedule.
+		 * @return The received response data, which may be partial if the transaction timed out.
+		 */
+		public final byte[] getResponse(int cycle, int transaction)
+		{
+			byte[] response = new byte[responseLengths[(cycle * numTransactions) + transaction]];
+			System.arraycopy(responseData, (cycle * responseSize) + responseOffsets[transaction], response, 0, response.length);
+			return response;
+		}
+		
+		/**
+		 * Returns the response time of the specified transaction in nanoseconds.
+		 * 
+		 * @param cycle The index of the cycle.
+		 * @param transaction The index of the transaction within the schedule.
+		 * @return The time between the start of the request and the end of the response.
+		 */
+		public final long getResponseTime(int cycle, int transaction) { return responseTimes[(cycle * numTransactions) + transaction]; }
+		
+		/**
+		 * Returns the duration of the specified cycle in nanoseconds.
+		 * 
+		 * @param cycle The index of the cycle.
+		 * @return The time it took to execute every transaction in the cycle.
+		 */
+		public final long getCycleTime(int cycle) { return cycleDurations[cycle]; }
+		
+		/**
+		 * Returns the shortest cycle time in nanoseconds.
+		 * 
+		 * @return The shortest duration of any completed cycle.
+		 */
+		public final long getMinCycleTime()
+		{
+			long minCycleTime = (numCompletedCycles > 0) ? Long.MAX_VALUE : 0;
+			for (int i = 0; i < numCompletedCycles; ++i)
+				minCycleTime = Math.min(minCycleTime, cycleDurations[i]);
+			return minCycleTime;
+		}
+		
+		/**
+		 * Returns the longest cycle time in nanoseconds.
+		 * 
+		 * @return The longest duration of any completed cycle.
+		 */
+		public final long getMaxCycleTime()
+		{
+			long maxCycleTime = 0;
+			for (int i = 0; i < numCompletedCycles; ++i)
+				maxCycleTime = Math.max(maxCycleTime, cycleDurations[i]);
+			return maxCycleTime;
+		}
+		
+		/**
+		 * Returns the mean cycle time in nanoseconds.
+		 * 
+		 * @return The mean duration of all completed cycles.
+		 */
+		public final long getMeanCycleTime()
+		{
+			long totalCycleTime = 0;
+			for (int i = 0; i < numCompletedCycles; ++i)
+				totalCycleTime += cycleDurations[i];
+			return (numCompletedCycles > 0) ? (totalCycleTime / numCompletedCycles) : 0;
+		}
+		
+		/**
+		 * Returns the cycle jitter in nanoseconds.
+		 * 
+		 * @return The largest deviation from the cycle period, or the spread of cycle times if no period was configured.
+		 */
+		public final long getCycleJitter()
+		{
+			if ((cyclePeriod <= 0) || (numCompletedCycles == 0))
+				return getMaxCycleTime() - getMinCycleTime();
+			
+			long maxJitter = 0;
+			for (int i = 1; i < numCompletedCycles; ++i)
+				maxJitter = Math.max(maxJitter, Math.abs(cycleStartTimes[i] - cycleStartTimes[0] - (i * cyclePeriod * 1000l)));
+			return maxJitter;
+		}
+	}
+	
+	/**
+	 * Represents a group of serial ports that can be written to and read from as a single unit.
+	 * <p>
+	 * A single buffer can be broadcast to every member of the group using one native call, in which the data is retrieved
+	 * from the Java heap only once and written to each port back-to-back.  Data received by any member of the group can also
+	 * be collected using a single call to {@link #readBytes(int,int)}.
+	 * <p>
+	 * This class is not thread-safe, and port groups are currently only supported on Linux.
+	 */
+	static public final class PortGroup
+	{
+		private final SerialComm[] ports;
+		private final int[] bytesWritten, bytesRead;
+		private final long[] writeTimes, arrivalTimes;
+		private byte[] receiveBuffer = new byte[0];
+		private long lastWriteSkew = 0;
+		
+		/**
+		 * Creates a new group containing the specified serial ports.
+		 * <p>
+		 * Each port must be opened and configured individually before it can be used as part of the group.
+		 * 
+		 * @param groupPorts The serial ports that make up this group.
+		 */
+		public PortGroup(SerialComm[] groupPorts)
+		{
+			ports = groupPorts.clone();
+			bytesWritten = new int[ports.length];
+			bytesRead = new int[ports.length];
+			writeTimes = new long[ports.length];
+			arrivalTimes = new long[ports.length];
+		}
+		
+		/**
+		 * Returns the serial ports that make up this group, in the order they were specified in the constructor.
+		 * 
+		 * @return An array of the SerialComm objects in this group.
+		 */
+		public final SerialComm[] getPorts() { return ports.clone(); }
+		
+		/**
+		 * Writes up to <i>bytesToWrite</i> raw data bytes from the buffer parameter to every open port in this group.
+		 * <p>
+		 * The per-port results of the most recent call can be retrieved using {@link #getBytesWritten(int)}, and the transmission
+		 * skew between the ports can be retrieved using {@link #getLastWriteSkew()}.
+		 * <p>
+		 * Ports in emulated RS-485 mode or with transmit pacing enabled are written exactly as {@link SerialComm#writeBytes(byte[],long)}
+		 * would, one at a time after the data has been handed to every other port, so they add to the transmission skew.
+		 * 
+		 * @param buffer The buffer containing the raw data to write to the serial ports.
+		 * @param bytesToWrite The number of bytes to write to each serial port.
+		 * @return The number of ports to which all <i>bytesToWrite</i> bytes were successfully written.
+		 */
+		public final int writeBytes(byte[] buffer, long bytesToWrite)
+		{
+			if ((bytesToWrite < 0) || (bytesToWrite > buffer.length))
+				throw new IndexOutOfBoundsException();
+			long firstWriteTime = Long.MAX_VALUE, lastWriteTime = Long.MIN_VALUE;
+			int numSuccessful = writeBytesToPorts(ports, buffer, bytesToWrite, bytesWritten, writeTimes);
+			for (int i = 0; i < ports.length; ++i)
+				if (bytesWritten[i] >= 0)
+				{
+					firstWriteTime = Math.min(firstWriteTime, writeTimes[i]);
+					lastWriteTime = Math.max(lastWriteTime, writeTimes[i]);
+				}
+			lastWriteSkew = (lastWriteTime >= firstWriteTime) ? (lastWriteTime - firstWriteTime) : 0;
+			return numSuccessful;
+		}
+		
+		/**
+		 * Returns the number of bytes written to the specified port during the most recent call to {@link #writeBytes(byte[],long)}.
+		 * 
+		 * @param portIndex The index of the port within this group.
+		 * @return The number of bytes written to the port, or -1 if the port was closed or an error occurred.
+		 */
+		public final int getBytesWritten(int portIndex) { return bytesWritten[portIndex]; }
+		
+		/**
+		 * Returns the number of nanoseconds that elapsed between the completion of the first and the last port write during the
+		 * most recent call to {@link #writeBytes(byte[],long)}.
+		 * 
+		 * @return The transmission skew across this group in nanoseconds.
+		 */
+		public final long getLastWriteSkew() { return lastWriteSkew; }
+		
+		/**
+		 * Waits for data to arrive on any port in this group and returns everything that was received.
+		 * <p>
+		 * Data that becomes available on several ports at the same time is returned in the same call with an identical arrival
+		 * time, in the order that the ports appear in this group.  Successive calls always return data in order of arrival.
+		 * <p>
+		 * A value of 0 for <i>timeout</i> indicates that this call should block until data is received or every port in the
+		 * group has been closed.
+		 * 
+		 * @param timeout The maximum number of milliseconds to wait for data to arrive.
+		 * @param maxBytesPerPort The maximum number of bytes to return for each port.
+		 * @return An array of {@link ReceivedData} objects, which is empty if the timeout elapsed without any data arriving.
+		 * @throws IOException If every port in the group has been closed or disconnected.
+		 */
+		public final ReceivedData[] readBytes(int timeout, int maxBytesPerPort) throws IOException
+		{
+			if (receiveBuffer.length != (ports.length * maxBytesPerPort))
+				receiveBuffer = new byte[ports.length * maxBytesPerPort];
+			int numReady = readBytesFromPorts(ports, receiveBuffer, maxBytesPerPort, bytesRead, arrivalTimes, timeout);
+			if (numReady < 0)
+				throw new IOException("All ports in this group appear to have been shutdown or disconnected.");
+			
+			ReceivedData[] receivedData = new ReceivedData[numReady];
+			for (int i = 0, index = 0; (i < ports.length) && (index < numReady); ++i)
+				if (bytesRead[i] > 0)
+				{
+					byte[] data = new byte[bytesRead[i]];
+					System.arraycopy(receiveBuffer, i * maxBytesPerPort, data, 0, bytesRead[i]);
+					receivedData[index++] = new ReceivedData(ports[i], data, arrivalTimes[i]);
+				}
+			return receivedData;
+		}
+	}
+	
+	/**
+	 * Represents a block of data received by a member of a {@link PortGroup}.
+	 */
+	static public final class ReceivedData
+	{
+		private final SerialComm port;
+		private final byte[] data;
+		private final long arrivalTime;
+		
+		private ReceivedData(SerialComm receivingPort, byte[] receivedData, long receiveTime)
+		{
+			port = receivingPort;
+			data = receivedData;
+			arrivalTime = receiveTime;
+		}
+		
+		/**
+		 * Returns the serial port on which this data was received.
+		 * 
+		 * @return The SerialComm object which received this data.
+		 */
+		public final SerialComm getPort() { return port; }
+		
+		/**
+		 * Returns the raw data bytes that were received.
+		 * 
+		 * @return The received data.
+		 */
+		public final byte[] getData() { return data; }
+		
+		/**
+		 * Returns the monotonic system time at which this data was received, in nanoseconds.
+		 * <p>
+		 * This value is only meaningful when compared to other arrival times.
+		 * 
+		 * @return The arrival time of this data in nanoseconds.
+		 */
+		public final long getArrivalTime() { return arrivalTime; }
+	}
+	
+	/**
+	 * Contains a histogram of thread wakeup latencies measured by {@link SerialComm#measureWakeupLatency}.
+	 * <p>
+	 * Latencies are sorted into buckets one microsecond wide, with the final bucket collecting every latency that does not fit into
+	 * any of the others.  All other times are reported in nanoseconds.
+	 */
+	static public final class LatencyHistogram
+	{
+		private final int[] bucketCounts = new int[1001];
+		private int numSamples = 0;
+		private long minLatency = 0, maxLatency = 0, totalLatency = 0;
+		private boolean realtimeApplied = false;
+		
+		private LatencyHistogram() {}
+		
+		/**
+		 * Returns the number of wakeups that were measured.
+		 * 
+		 * @return The number of latency samples.
+		 */
+		public final int getNumSamples() { return numSamples; }
+		
+		/**
+		 * Returns the number of one-microsecond buckets in this histogram, including the final overflow bucket.
+		 * 
+		 * @return The number of histogram buckets.
+		 */
+		public final int getNumBuckets() { return bucketCounts.length; }
+		
+		/**
+		 * Returns the number of wakeups whose latency fell into the specified bucket.
+		 * 
+		 * @param microseconds The latency in whole microseconds, which selects the bucket.
+		 * @return The number of wakeups with this latency.
+		 */
+		public final int getBucketCount(int microseconds) { return bucketCounts[Math.min(microseconds, bucketCounts.length - 1)]; }
+		
+		/**
+		 * Returns the smallest measured latency in nanoseconds.
+		 * 
+		 * @return The minimum wakeup latency.
+		 */
+		public final long getMinLatency() { return minLatency; }
+		
+		/**
+		 * Returns the largest measured latency in nanoseconds.
+		 * 
+		 * @return The maximum wakeup latency.
+		 */
+		public final long getMaxLatency() { return maxLatency; }
+		
+		/**
+		 * Returns the mean measured latency in nanoseconds.
+		 * 
+		 * @return The mean wakeup latency.
+		 */
+		public final long getMeanLatency() { return (numSamples > 0) ? (totalLatency / numSamples) : 0; }
+		
+		/**
+		 * Returns the latency in microseconds below which the specified percentage of wakeups occurred.
+		 * 
+		 * @param percentile The percentage of wakeups, from 0 to 100.
+		 * @return The upper bound of the bucket containing the percentile, or {@link #getNumBuckets()} if it falls into the overflow bucket.
+		 */
+		public final int getPercentileLatency(double percentile)
+		{
+			long cumulativeCount = 0, targetCount = (long)Math.ceil((percentile / 100.0) * numSamples);
+			for (int i = 0; i < bucketCounts.length; ++i)
+				if ((cumulativeCount += bucketCounts[i]) >= targetCount)
+					return i + 1;
+			return bucketCounts.length;
+		}
+		
+		/**
+		 * Returns whether all of the real-time settings of the port were successfully applied while measuring.
+		 * 
+		 * @return Whether the real-time settings were in effect.
+		 */
+		public final boolean isRealtimeApplied() { return realtimeApplied; }
+	}
+	
+	/**
+	 * Snapshot of the transmit gaps that were requested and achieved by paced writes on a serial port.
+	 * <p>
+	 * Achieved gaps are measured on the monotonic clock from the calculated end of the previous character (or the drained end of the
+	 * previous write) to the moment the next character was handed to the driver.  All times are reported in nanoseconds.
+	 * 
+	 * @see SerialComm#setTransmitPacing(double,double,int)
+	 */
+	static public final class PacingStatistics
+	{
+		private final long[] statistics;
+		
+		private PacingStatistics(long[] statistics) { this.statistics = statistics; }
+		
+		/**
+		 * Returns the inter-byte gap that was requested by the most recent paced write.
+		 * 
+		 * @return The requested inter-byte gap.
+		 */
+		public final long getRequestedByteGap() { return statistics[8]; }
+		
+		/**
+		 * Returns the number of inter-byte gaps that were measured.
+		 * 
+		 * @return The number of inter-byte gap samples.
+		 */
+		public final long getNumByteGaps() { return statistics[0]; }
+		
+		/**
+		 * Returns the smallest achieved inter-byte gap.
+		 * 
+		 * @return The minimum inter-byte gap.
+		 */
+		public final long getMinByteGap() { return statistics[2]; }
+		
+		/**
+		 * Returns the largest achieved inter-byte gap.
+		 * 
+		 * @return The maximum inter-byte gap.
+		 */
+		public final long getMaxByteGap() { return statistics[3]; }
+		
+		/**
+		 * Returns the mean achieved inter-byte gap.
+		 * 
+		 * @return The mean inter-byte gap.
+		 */
+		public final long getMeanByteGap() { return (statistics[0] > 0) ? (statistics[1] / statistics[0]) : 0; }
+		
+		/**
+		 * Returns the inter-frame gap that was requested by the most recent paced write.
+		 * 
+		 * @return The requested inter-frame gap.
+		 */
+		public final long getRequestedFrameGap() { return statistics[9]; }
+		
+		/**
+		 * Returns the number of inter-frame gaps that were measured.
+		 * 
+		 * @return The number of inter-frame gap samples.
+		 */
+		public final long getNumFrameGaps() { return statistics[4]; }
+		
+		/**
+		 * Returns the smallest achieved inter-frame gap.
+		 * 
+		 * @return The minimum inter-frame gap.
+		 */
+		public final long getMinFrameGap() { return statistics[6]; }
+		
+		/**
+		 * Returns the largest achieved inter-frame gap.
+		 * 
+		 * @return The maximum inter-frame gap.
+		 */
+		public final long getMaxFrameGap() { return statistics[7]; }
+		
+		/**
+		 * Returns the mean achieved inter-frame gap.
+		 * 
+		 * @return The mean inter-frame gap.
+		 */
+		public final long getMeanFrameGap() { return (statistics[4] > 0) ? (statistics[5] / statistics[4]) : 0; }
+	}
+	
+	/**
+	 * Native parser for u-blox UBX and NMEA 0183 messages received from a GNSS receiver.
+	 * <p>
+	 * Raw receiver data is framed and checksum-verified natively, resynchronizing on the UBX sync characters (0xB5 0x62) and
+	 * on the '$' character which starts every NMEA sentence.  Valid messages are written back-to-back into a reusable direct
+	 * {@link java.nio.ByteBuffer}, so that no objects are allocated while parsing.  Corrupt messages are counted and dropped.
+	 * <p>
+	 * After each call to {@link #readMessages(int)} or {@link #parse(byte[],int,int)}, the decoded messages can be visited by
+	 * calling {@link #nextMessage()} repeatedly.  Each message is stored in the buffer as a 16-byte little-endian header followed
+	 * by its payload: the UBX payload excluding class, ID, length, and checksum, or the NMEA sentence text between the '$' and
+	 * '*' characters.  Since UBX fields are also little-endian, they can be read directly from the buffer, starting at
+	 * {@link #getPayloadOffset()}.
+	 * <p>
+	 * This class is not thread-safe, and reading messages from a serial port is currently only supported on Linux.
+	 */
+	static public final class GnssParser
+	{
+		private final SerialComm port;
+		private final ByteBuffer messageBuffer;
+		private long parserState;
+		private int outputLength = 0, numMessages = 0, nextPosition = 0;
+		private int messageType = 0, ubxClass = 0, ubxId = 0, payloadLength = 0, payloadOffset = 0;
+		private long messageTime = 0;
+		private long numUbxMessages = 0, numNmeaMessages = 0, numChecksumErrors = 0, numDiscardedBytes = 0;
+		
+		/**
+		 * Creates a GNSS parser attached to the specified serial port.
+		 * <p>
+		 * The message buffer must be large enough to hold the largest expected message along with its 16-byte header, and any
+		 * message with a payload longer than <i>maxMessageLength</i> bytes is treated as corrupt.
+		 * 
+		 * @param receiverPort The open serial port connected to the GNSS receiver, or null to only parse recorded data.
+		 * @param maxMessageLength The maximum length of a single message in bytes.
+		 * @param bufferSize The size of the message buffer in bytes.
+		 */
+		public GnssParser(SerialComm receiverPort, int maxMessageLength, int bufferSize)
+		{
+			port = receiverPort;
+			messageBuffer = ByteBuffer.allocateDirect(Math.max(bufferSize, maxMessageLength + 20)).order(ByteOrder.LITTLE_ENDIAN);
+			parserState = createGnssParser(messageBuffer, maxMessageLength + 4);
+		}
+		
+		/**
+		 * Creates a GNSS parser attached to the specified serial port, using a maximum message length of 8 kB and a
+		 * message buffer of 64 kB.
+		 * 
+		 * @param receiverPort The open serial port connected to the GNSS receiver, or null to only parse recorded data.
+		 */
+		public GnssParser(SerialComm receiverPort) { this(receiverPort, 8192, 65536); }
+		
+		/**
+		 * Reads from the attached serial port until at least one complete message has been decoded or the timeout expires.
+		 * <p>
+		 * Any messages already present in the message buffer are discarded.
+		 * 
+		 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+		 * @return The number of messages that were decoded.
+		 * @throws IOException If the port was closed or disconnected.
+		 */
+		public final int readMessages(int timeout) throws IOException
+		{
+			if ((port == null) || (parserState == 0) || (port.readGnssData(this, timeout) < 0))
+				throw new IOException("This port appears to have been shutdown or disconnected.");
+			return numMessages;
+		}
+		
+		/**
+		 * Parses a block of previously recorded receiver data.
+		 * <p>
+		 * Any messages already present in the message buffer are discarded.  If the buffer fills up before all of the data has been
+		 * parsed, the number of bytes actually consumed is returned, and the remaining data should be passed to this method again
+		 * after the decoded messages have been processed.
+		 * 
+		 * @param data The buffer containing the raw receiver data.
+		 * @param offset The offset of the first byte to parse.
+		 * @param length The number of bytes to parse.
+		 * @return The number of bytes that were consumed.
+		 */
+		public final int parse(byte[] data, int offset, int length)
+		{
+			if ((offset < 0) || (length < 0) || (length > data.length - offset))
+				throw new IndexOutOfBoundsException();
+			return (parserState == 0) ? 0 : parseGnssData(this, data, offset, length);
+		}
+		
+		/**
+		 * Advances to the next decoded message in the message buffer.
+		 * 
+		 * @return Whether another message was available.
+		 */
+		public final boolean nextMessage()
+		{
+			if (nextPosition >= outputLength)
+				return false;
+			messageType = messageBuffer.get(nextPosition);
+			ubxClass = messageBuffer.get(nextPosition + 1) & 0xFF;
+			ubxId = messageBuffer.get(nextPosition + 2) & 0xFF;
+			payloadLength = messageBuffer.getInt(nextPosition + 4);
+			messageTime = messageBuffer.getLong(nextPosition + 8);
+			payloadOffset = nextPosition + 16;
+			nextPosition = payloadOffset + payloadLength;
+			return true;
+		}
+		
+		/**
+		 * Returns the number of messages decoded by the most recent read or parse.
+		 * 
+		 * @return The number of messages in the message buffer.
+		 */
+		public final int getNumMessages() { return numMessages; }
+		
+		/**
+		 * Returns the type of the current message, which should be compared with the built-in GNSS message type constants
+		 * ({@link SerialComm#GNSS_MESSAGE_UBX}, {@link SerialComm#GNSS_MESSAGE_NMEA}).
+		 * 
+		 * @return The type of the current message.
+		 */
+		public final int getMessageType() { return messageType; }
+		
+		/**
+		 * Returns the class of the current UBX message.
+		 * 
+		 * @return The UBX message class, or 0 for NMEA messages.
+		 */
+		public final int getUbxClass() { return ubxClass; }
+		
+		/**
+		 * Returns the ID of the current UBX message.
+		 * 
+		 * @return The UBX message ID, or 0 for NMEA messages.
+		 */
+		public final int getUbxId() { return ubxId; }
+		
+		/**
+		 * Returns the length of the payload of the current message.
+		 * 
+		 * @return The payload length in bytes.
+		 */
+		public final int getPayloadLength() { return payloadLength; }
+		
+		/**
+		 * Returns the position of the payload of the current message within the message buffer.
+		 * 
+		 * @return The offset of the first payload byte.
+		 * @see #getMessageBuffer()
+		 */
+		public final int getPayloadOffset() { return payloadOffset; }
+		
+		/**
+		 * Returns the monotonic system time at which the data completing the current message was received, in nanoseconds.
+		 * 
+		 * @return The receive time of the current message.
+		 */
+		public final long getMessageTime() { return messageTime; }
+		
+		/**
+		 * Returns the reusable little-endian buffer containing all decoded messages.
+		 * 
+		 * @return The message buffer.
+		 */
+		public final ByteBuffer getMessageBuffer() { return messageBuffer; }
+		
+		/**
+		 * Returns the total number of valid UBX messages decoded by this parser.
+		 * 
+		 * @return The number of UBX messages.
+		 */
+		public final long getNumUbxMessages() { return numUbxMessages; }
+		
+		/**
+		 * Returns the total number of valid NMEA sentences decoded by this parser.
+		 * 
+		 * @return The number of NMEA sentences.
+		 */
+		public final long getNumNmeaMessages() { return numNmeaMessages; }
+		
+		/**
+		 * Returns the total number of messages dropped because of a checksum mismatch.
+		 * 
+		 * @return The number of checksum errors.
+		 */
+		public final long getNumChecksumErrors() { return numChecksumErrors; }
+		
+		/**
+		 * Returns the total number of bytes which were not part of any valid message.
+		 * 
+		 * @return The number of discarded bytes.
+		 */
+		public final long getNumDiscardedBytes() { return numDiscardedBytes; }
+		
+		/**
+		 * Releases the native resources held by this parser.
+		 */
+		public final void close()
+		{
+			if (parserState != 0)
+				destroyGnssParser(parserState);
+			parserState = 0;
+		}
+		
+		protected final void finalize() throws Throwable
+		{
+			close();
+			super.finalize();
+		}
+	}
+	
+	/**
+	 * Shares a single open serial port with other processes on the same machine through shared memory.
+	 * <p>
+	 * Since a serial port can only be opened by one process at a time, a port broker lets the owning process publish everything
+	 * received by the port into a shared memory ring that any number of other processes can read from concurrently using a
+	 * {@link PortBrokerClient}.  The data is copied by the kernel directly from the port into shared memory, and from there directly
+	 * into each client's buffer.  Clients can also transmit data through the broker, in which case each client write is sent to the
+	 * port as one uninterrupted block.
+	 * <p>
+	 * Once {@link #start()} has been called, the broker services the port using two daemon threads until {@link #close()} is
+	 * called or the port is closed or disconnected.  The port should not be read from directly while the broker is running.
+	 * <p>
+	 * Port brokers are currently only supported on Linux.
+	 */
+	static public final class PortBroker
+	{
+		private final SerialComm port;
+		private final String name;
+		private long brokerState;
+		private Thread publisherThread = null, transmitterThread = null;
+		
+		/**
+		 * Creates a port broker for the specified open serial port.
+		 * <p>
+		 * The receive ring must be large enough to hold all data published while the slowest client is not reading, or that
+		 * client will lose data.  Any broker of the same name left behind by a process which did not shut down cleanly is replaced.
+		 * 
+		 * @param ownerPort The open serial port to share.
+		 * @param brokerName The system-wide name that clients use to attach to this broker, which must not contain a '/' character.
+		 * @param ringSize The size of the shared receive ring in bytes.
+		 * @param writeRingSize The size of the shared transmit ring in bytes.
+		 * @throws IOException If the shared memory could not be created.
+		 */
+		public PortBroker(SerialComm ownerPort, String brokerName, int ringSize, int writeRingSize) throws IOException
+		{
+			port = ownerPort;
+			name = brokerName;
+			if ((ringSize <= 0) || (writeRingSize <= 0) || (brokerName.indexOf('/') >= 0) || ((brokerState = createPortBroker(brokerName, ringSize, writeRingSize)) == 0))
+				throw new IOException("Unable to create the shared memory for port broker " + brokerName + ".");
+		}
+		
+		/**
+		 * Creates a port broker for the specified open serial port, using a 1 MB receive ring and a 64 kB transmit ring.
+		 * 
+		 * @param ownerPort The open serial port to share.
+		 * @param brokerName The system-wide name that clients use to attach to this broker, which must not contain a '/' character.
+		 * @throws IOException If the shared memory could not be created.
+		 */
+		public PortBroker(SerialComm ownerPort, String brokerName) throws IOException { this(ownerPort, brokerName, 1024 * 1024, 64 * 1024); }
+		
+		/**
+		 * Starts publishing data received by the port and transmitting data queued by clients.
+		 */
+		public final synchronized void start()
+		{
+			if ((brokerState == 0) || (publisherThread != null))
+				return;
+			final long state = brokerState;
+			publisherThread = new Thread(new Runnable() { public void run() { port.publishToBroker(state); } }, "PortBroker-" + name + "-publisher");
+			transmitterThread = new Thread(new Runnable() { public void run() { port.transmitFromBroker(state); } }, "PortBroker-" + name + "-transmitter");
+			publisherThread.setDaemon(true);
+			transmitterThread.setDaemon(true);
+			publisherThread.start();
+			transmitterThread.start();
+		}
+		
+		/**
+		 * Returns the system-wide name of this broker.
+		 * 
+		 * @return The name that clients use to attach to this broker.
+		 */
+		public final String getName() { return name; }
+		
+		/**
+		 * Stops the broker, notifies all attached clients, and removes its shared memory.
+		 * <p>
+		 * The serial port itself remains open.
+		 */
+		public final synchronized void close()
+		{
+			if (brokerState == 0)
+				return;
+			stopPortBroker(brokerState);
+			try
+			{
+				if (publisherThread != null)
+					publisherThread.join();
+				if (transmitterThread != null)
+					transmitterThread.join();
+			} catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+			detachPortBroker(brokerState);
+			brokerState = 0;
+		}
+	}
+	
+	/**
+	 * Read-only view of a serial port shared by a {@link PortBroker} in another process, along with a write path through that broker.
+	 * <p>
+	 * Each client has its own read position, starting with the first byte published after it attached.  A client which falls
+	 * further behind than the size of the broker's receive ring skips ahead to the oldest data still available, and the number of
+	 * bytes it missed is reported by {@link #getNumBytesLost()}.
+	 * <p>
+	 * This class is not thread-safe, and port brokers are currently only supported on Linux.
+	 */
+	static public final class PortBrokerClient
+	{
+		private long brokerState;
+		private long numBytesLost = 0;
+		
+		/**
+		 * Attaches to the port broker with the specified name.
+		 * 
+		 * @param brokerName The system-wide name of the broker.
+		 * @throws IOException If no broker with this name exists.
+		 */
+		public PortBrokerClient(String brokerName) throws IOException
+		{
+			if ((brokerName.indexOf('/') >= 0) || ((brokerState = attachPortBroker(brokerName)) == 0))
+				throw new IOException("Unable to attach to port broker " + brokerName + ".");
+		}
+		
+		/**
+		 * Returns the number of bytes that can be read without blocking.
+		 * 
+		 * @return The number of bytes published but not yet read by this client.
+		 */
+		public final int bytesAvailable() { return (brokerState == 0) ? -1 : brokerBytesAvailable(brokerState); }
+		
+		/**
+		 * Reads up to <i>length</i> bytes published by the broker, blocking until at least one byte is available or the timeout expires.
+		 * 
+		 * @param buffer The buffer into which the data is read.
+		 * @param offset The position in the buffer at which to store the data.
+		 * @param length The maximum number of bytes to read.
+		 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+		 * @return The number of bytes read, which is 0 if the timeout expired.
+		 * @throws IOException If the broker was shut down and all of its data has been read.
+		 */
+		public final int readBytes(byte[] buffer, int offset, int length, int timeout) throws IOException
+		{
+			if ((offset < 0) || (length < 0) || (length > buffer.length - offset))
+				throw new IndexOutOfBoundsException();
+			int numBytesRead = (brokerState == 0) ? -1 : (length == 0) ? 0 : readFromBroker(this, buffer, offset, length, timeout);
+			if (numBytesRead < 0)
+				throw new IOException("The port broker appears to have been shutdown or disconnected.");
+			return numBytesRead;
+		}
+		
+		/**
+		 * Queues data for transmission by the broker.
+		 * <p>
+		 * The data is sent to the port as one uninterrupted block, even if other clients are writing at the same time.  This method
+		 * returns once all of the data has been queued, which may be before it has been transmitted.
+		 * 
+		 * @param buffer The buffer containing the data to send.
+		 * @param offset The position in the buffer of the first byte to send.
+		 * @param length The number of bytes to send.
+		 * @throws IOException If the broker was shut down.
+		 */
+		public final void writeBytes(byte[] buffer, int offset, int length) throws IOException
+		{
+			if ((offset < 0) || (length < 0) || (length > buffer.length - offset))
+				throw new IndexOutOfBoundsException();
+			if ((brokerState == 0) || (writeToBroker(brokerState, buffer, offset, length) < 0))
+				throw new IOException("The port broker appears to have been shutdown or disconnected.");
+		}
+		
+		/**
+		 * Returns the total number of published bytes which this client missed because it fell too far behind.
+		 * 
+		 * @return The number of bytes lost.
+		 */
+		public final long getNumBytesLost() { return numBytesLost; }
+		
+		/**
+		 * Detaches this client from the broker.
+		 */
+		public final void close()
+		{
+			if (brokerState != 0)
+				detachPortBroker(brokerState);
+			brokerState = 0;
+		}
+	}
+	
+	/**
+	 * Interface for receiving notifications when a serial port is disconnected or automatically reconnected.
+	 * 
+	 * @see SerialComm#setAutoReconnect(boolean,int)
+	 * @see SerialComm#setConnectionListener(ConnectionListener)
+	 */
+	static public interface ConnectionListener
+	{
+		/**
+		 * Called after the port has hung up and been closed, before any attempt to reconnect it.
+		 * 
+		 * @param port The serial port that was disconnected.
+		 */
+		public void portDisconnected(SerialComm port);
+		
+		/**
+		 * Called after the port has been reopened with all of its settings, before the data queued while disconnected is sent.
+		 * 
+		 * @param port The serial port that was reconnected.
+		 */
+		public void portReconnected(SerialComm port);
+	}
+	
+	/**
+	 * Fixed pool of reusable native receive buffers for a serial port.
+	 * <p>
+	 * All buffers are carved out of a single slab of native memory when the pool is created and exposed as direct
+	 * {@link ByteBuffer}s, so data is read natively straight into a buffer without passing through the Java heap.  The application
+	 * borrows a filled buffer using {@link #receive(int)} and hands it back using {@link PooledBuffer#release()} when it is done
+	 * with the data.  Once the pool has been created, receiving data does not allocate any Java objects.
+	 * <p>
+	 * Occupancy metrics show how close the pool came to running out of buffers.  In leak detection mode, the stack trace of every
+	 * borrow is recorded, so buffers which were never released can be tracked down using {@link #reportLeaks(long,PrintStream)}.
+	 * <p>
+	 * Receive buffer pools are currently only supported on Linux.
+	 */
+	static public final class ReceiveBufferPool
+	{
+		private final SerialComm port;
+		private final PooledBuffer[] buffers;
+		private final int[] freeBuffers;
+		private final int bufferSize;
+		private long poolState;
+		private int numFree, peakBorrowed = 0;
+		private long numBorrows = 0, numExhausted = 0;
+		private boolean closed = false;
+		private volatile boolean leakDetection = false;
+		
+		/**
+		 * Creates a pool of receive buffers for the specified serial port.
+		 * 
+		 * @param receivePort The serial port to receive data from.
+		 * @param numBuffers The number of buffers in the pool, which limits how many can be borrowed at once.
+		 * @param bufferSize The maximum number of bytes received into each buffer.
+		 * @throws IOException If the native memory for the pool could not be allocated.
+		 */
+		public ReceiveBufferPool(SerialComm receivePort, int numBuffers, int bufferSize) throws IOException
+		{
+			port = receivePort;
+			this.bufferSize = bufferSize;
+			if ((numBuffers <= 0) || (bufferSize <= 0) || ((poolState = createReceiveBufferPool(numBuffers, bufferSize)) == 0))
+				throw new IOException("Unable to allocate " + numBuffers + " receive buffers of " + bufferSize + " bytes.");
+			buffers = new PooledBuffer[numBuffers];
+			freeBuffers = new int[numBuffers];
+			for (int i = 0; i < numBuffers; ++i)
+			{
+				buffers[i] = new PooledBuffer(this, i, getReceiveBuffer(poolState, i));
+				freeBuffers[i] = numBuffers - 1 - i;
+			}
+			numFree = numBuffers;
+		}
+		
+		/**
+		 * Borrows a buffer from the pool and reads whatever data arrives into it, waiting until at least one byte is available or
+		 * the timeout expires.
+		 * <p>
+		 * The returned buffer's position is 0 and its limit is the number of bytes received.  It must be handed back using
+		 * {@link PooledBuffer#release()} once its contents are no longer needed.
+		 * 
+		 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+		 * @return The filled buffer, or null if the timeout expired or every buffer in the pool is currently borrowed.
+		 * @throws IOException If the port was closed or disconnected.
+		 */
+		public final PooledBuffer receive(int timeout) throws IOException
+		{
+			PooledBuffer buffer = borrow();
+			if (buffer == null)
+				return null;
+			int numBytesRead = port.readIntoPooledBuffer(buffer, timeout);
+			if (numBytesRead <= 0)
+			{
+				buffer.release();
+				if (numBytesRead < 0)
+					throw new IOException("This port appears to have been shutdown or disconnected.");
+				return null;
+			}
+			buffer.data.clear();
+			buffer.data.limit(numBytesRead);
+			return buffer;
+		}
+		
+		private final synchronized PooledBuffer borrow()
+		{
+			if (closed)
+				return null;
+			else if (numFree == 0)
+			{
+				++numExhausted;
+				return null;
+			}
+			PooledBuffer buffer = buffers[freeBuffers[--numFree]];
+			buffer.borrowed = true;
+			buffer.borrowTime = System.nanoTime();
+			buffer.borrowTrace = leakDetection ? new Throwable("Receive buffer borrowed here") : null;
+			peakBorrowed = Math.max(peakBorrowed, buffers.length - numFree);
+			++numBorrows;
+			return buffer;
+		}
+		
+		private final synchronized void giveBack(PooledBuffer buffer)
+		{
+			if (!buffer.borrowed)
+				throw new IllegalStateException("Receive buffer " + buffer.index + " was released more than once.");
+			buffer.borrowed = false;
+			buffer.borrowTrace = null;
+			freeBuffers[numFree++] = buffer.index;
+			if (closed && (numFree == buffers.length))
+				freePool();
+		}
+		
+		/**
+		 * Returns the total number of buffers in this pool.
+		 * 
+		 * @return The pool capacity.
+		 */
+		public final int getNumBuffers() { return buffers.length; }
+		
+		/**
+		 * Returns the maximum number of bytes received into each buffer.
+		 * 
+		 * @return The size of a single buffer.
+		 */
+		public final int getBufferSize() { return bufferSize; }
+		
+		/**
+		 * Returns the number of buffers that are currently borrowed.
+		 * 
+		 * @return The number of buffers in use.
+		 */
+		public final synchronized int getNumBorrowed() { return buffers.length - numFree; }
+		
+		/**
+		 * Returns the largest number of buffers that were borrowed at the same time.
+		 * 
+		 * @return The peak pool occupancy.
+		 */
+		public final synchronized int getPeakBorrowed() { return peakBorrowed; }
+		
+		/**
+		 * Returns the total number of buffers that have been borrowed.
+		 * 
+		 * @return The number of borrows.
+		 */
+		public final synchronized long getNumBorrows() { return numBorrows; }
+		
+		/**
+		 * Returns the number of times data could not be received because every buffer was already borrowed.
+		 * 
+		 * @return The number of failed borrows.
+		 */
+		public final synchronized long getNumExhausted() { return numExhausted; }
+		
+		/**
+		 * Enables or disables leak detection mode.
+		 * <p>
+		 * In leak detection mode, a stack trace is captured every time a buffer is borrowed, so this mode does allocate memory on
+		 * the Java heap and should only be used while debugging.
+		 * 
+		 * @param enabled Whether to record where each buffer was borrowed.
+		 */
+		public final void setLeakDetection(boolean enabled) { leakDetection = enabled; }
+		
+		/**
+		 * Prints every buffer that has been borrowed for at least the specified amount of time, along with the stack trace of
+		 * where it was borrowed if leak detection mode was enabled at the time.
+		 * 
+		 * @param minAgeMilliseconds The minimum number of milliseconds a buffer must have been borrowed for to be reported.
+		 * @param output The stream to print the report to.
+		 * @return The number of buffers that were reported.
+		 */
+		public final synchronized int reportLeaks(long minAgeMilliseconds, PrintStream output)
+		{
+			int numReported = 0;
+			long currentTime = System.nanoTime();
+			for (int i = 0; i < buffers.length; ++i)
+				if (buffers[i].borrowed && (((currentTime - buffers[i].borrowTime) / 1000000) >= minAgeMilliseconds))
+				{
+					++numReported;
+					output.println("Receive buffer " + i + " has not been released for " + ((currentTime - buffers[i].borrowTime) / 1000000) + " ms.");
+					if (buffers[i].borrowTrace != null)
+						buffers[i].borrowTrace.printStackTrace(output);
+				}
+			return numReported;
+		}
+		
+		/**
+		 * Releases the native memory held by this pool.
+		 * <p>
+		 * No more buffers can be borrowed after calling this method.  Buffers that are still borrowed, including those that a
+		 * {@link #receive(int)} call is currently reading into, remain valid until they are released, and the native memory is
+		 * only freed once the last of them has been handed back.  In leak detection mode, any buffers that are still borrowed are
+		 * reported to {@link System#err}.
+		 */
+		public final synchronized void close()
+		{
+			if (closed)
+				return;
+			closed = true;
+			if (leakDetection)
+				reportLeaks(0, System.err);
+			if (numFree == buffers.length)
+				freePool();
+		}
+		
+		// Frees the native memory behind every buffer, which must no longer be borrowed
+		private final void freePool()
+		{
+			if (poolState != 0)
+				destroyReceiveBufferPool(poolState);
+			poolState = 0;
+		}
+		
+		protected final void finalize() throws Throwable
+		{
+			// Borrowed buffers keep their pool reachable, so none of them can still be in use here
+			synchronized (this)
+			{
+				closed = true;
+				freePool();
+			}
+			super.finalize();
+		}
+	}
+	
+	/**
+	 * Receive buffer borrowed from a {@link ReceiveBufferPool}.
+	 */
+	static public final class PooledBuffer
+	{
+		private final ReceiveBufferPool pool;
+		private final int index;
+		private final ByteBuffer data;
+		private long arrivalTime = 0, borrowTime = 0;
+		private boolean borrowed = false;
+		private Throwable borrowTrace = null;
+		
+		private PooledBuffer(ReceiveBufferPool pool, int index, ByteBuffer data)
+		{
+			this.pool = pool;
+			this.index = index;
+			this.data = data;
+		}
+		
+		/**
+		 * Returns the direct buffer holding the received data, from its position up to its limit.
+		 * 
+		 * @return The received data.
+		 */
+		public final ByteBuffer getData() { return data; }
+		
+		/**
+		 * Returns the monotonic system time in nanoseconds at which the data was read from the port.
+		 * 
+		 * @return The arrival time of the data.
+		 */
+		public final long getArrivalTime() { return arrivalTime; }
+		
+		/**
+		 * Hands this buffer back to its pool, after which it must no longer be used.
+		 */
+		public final void release() { pool.giveBack(this); }
+	}
+	
+	/**
+	 * Precompiled set of byte patterns to wait for using {@link SerialComm#expect(ExpectPatterns,int)}.
+	 * <p>
+	 * The patterns are compiled into a native Aho-Corasick automaton once, so the same set of expected responses (for example,
+	 * "OK", "ERROR", and "+CME ERROR:" for an AT-command modem) can be reused for any number of commands.  If more than one
+	 * pattern ends at the same byte, the longest one is reported.  Empty patterns never match.
+	 */
+	static public final class ExpectPatterns
+	{
+		private final int numPatterns;
+		private long automatonState;
+		
+		/**
+		 * Compiles the specified byte patterns.
+		 * 
+		 * @param patterns The byte sequences to wait for.
+		 */
+		public ExpectPatterns(byte[][] patterns)
+		{
+			numPatterns = patterns.length;
+			automatonState = createExpectAutomaton(patterns);
+		}
+		
+		/**
+		 * Compiles the specified text patterns.
+		 * 
+		 * @param patterns The strings to wait for, each character of which is matched as a single byte.
+		 */
+		public ExpectPatterns(String[] patterns) { this(toBytes(patterns)); }
+		
+		static private byte[][] toBytes(String[] patterns)
+		{
+			byte[][] patternBytes = new byte[patterns.length][];
+			for (int i = 0; i < patterns.length; ++i)
+			{
+				patternBytes[i] = new byte[patterns[i].length()];
+				for (int j = 0; j < patternBytes[i].length; ++j)
+					patternBytes[i][j] = (byte)patterns[i].charAt(j);
+			}
+			return patternBytes;
+		}
+		
+		/**
+		 * Returns the number of patterns in this set.
+		 * 
+		 * @return The number of patterns.
+		 */
+		public final int getNumPatterns() { return numPatterns; }
+		
+		/**
+		 * Releases the native resources held by this pattern set.
+		 */
+		public final void close()
+		{
+			if (automatonState != 0)
+				destroyExpectAutomaton(automatonState);
+			automatonState = 0;
+		}
+		
+		protected final void finalize() throws Throwable
+		{
+			close();
+			super.finalize();
+		}
+	}
+	
+	/**
+	 * Result of waiting for a set of patterns using {@link SerialComm#expect(ExpectPatterns,int)}.
+	 */
+	static public final class ExpectResult
+	{
+		private int patternIndex = -1;
+		private byte[] data = null;
+		
+		private ExpectResult() {}
+		
+		/**
+		 * Returns the index of the pattern that was matched.
+		 * 
+		 * @return The index of the matched pattern, or -1 if the timeout expired first.
+		 */
+		public final int getPatternIndex() { return patternIndex; }
+		
+		/**
+		 * Returns whether the timeout expired before any of the patterns was received.
+		 * 
+		 * @return Whether the expect operation timed out.
+		 */
+		public final boolean isTimedOut() { return patternIndex == -1; }
+		
+		/**
+		 * Returns all of the data that was read from the port, ending with the matched pattern unless the timeout expired.
+		 * 
+		 * @return The consumed data.
+		 */
+		public final byte[] getData() { return data; }
+		
+		/**
+		 * Returns all of the data that was read from the port as text, treating each byte as a single character.
+		 * 
+		 * @return The consumed data as a string.
+		 */
+		public final String getResponse()
+		{
+			char[] characters = new char[data.length];
+			for (int i = 0; i < data.length; ++i)
+				characters[i] = (char)(data[i] & 0xFF);
+			return new String(characters);
+		}
+	}
+	
+	/**
+	 * Contains the per-port results of opening a group of serial ports using {@link SerialComm#openPorts(SerialComm[],SerialComm)}.
+	 * <p>
+	 * All times are reported in nanoseconds.
+	 */
+	static public final class OpenResults
+	{
+		private final SerialComm[] ports;
+		private final boolean[] opened;
+		private final long[] openTimes;
+		private int numOpened = 0;
+		private long totalTime = 0;
+		
+		private OpenResults(SerialComm[] openedPorts)
+		{
+			ports = openedPorts.clone();
+			opened = new boolean[ports.length];
+			openTimes = new long[ports.length];
+		}
+		
+		/**
+		 * Returns the serial ports that were opened, in the order they were specified.
+		 * 
+		 * @return An array of the SerialComm objects that were opened.
+		 */
+		public final SerialComm[] getPorts() { return ports.clone(); }
+		
+		/**
+		 * Returns the number of ports that were successfully opened.
+		 * 
+		 * @return The number of opened ports.
+		 */
+		public final int getNumOpened() { return numOpened; }
+		
+		/**
+		 * Returns whether the specified port was successfully opened.
+		 * 
+		 * @param portIndex The index of the port in the array passed to {@link SerialComm#openPorts(SerialComm[],SerialComm)}.
+		 * @return Whether the port was opened.
+		 */
+		public final boolean isOpened(int portIndex) { return opened[portIndex]; }
+		
+		/**
+		 * Returns the time it took to open and configure the specified port, whether or not it succeeded.
+		 * 
+		 * @param portIndex The index of the port in the array passed to {@link SerialComm#openPorts(SerialComm[],SerialComm)}.
+		 * @return The time spent opening the port.
+		 */
+		public final long getOpenTime(int portIndex) { return openTimes[portIndex]; }
+		
+		/**
+		 * Returns the longest time it took to open and configure any single port.
+		 * 
+		 * @return The open time of the slowest port.
+		 */
+		public final long getMaxOpenTime()
+		{
+			long maxOpenTime = 0;
+			for (int i = 0; i < openTimes.length; ++i)
+				maxOpenTime = Math.max(maxOpenTime, openTimes[i]);
+			return maxOpenTime;
+		}
+		
+		/**
+		 * Returns the sum of the times it took to open and configure each port, which is roughly how long opening them one after
+		 * another would have taken.
+		 * 
+		 * @return The combined open time of all ports.
+		 */
+		public final long getSerialOpenTime()
+		{
+			long serialOpenTime = 0;
+			for (int i = 0; i < openTimes.length; ++i)
+				serialOpenTime += openTimes[i];
+			return serialOpenTime;
+		}
+		
+		/**
+		 * Returns the time it took to open the entire group of ports.
+		 * 
+		 * @return The elapsed time of the bulk open operation.
+		 */
+		public final long getTotalTime() { return totalTime; }
+	}
+	
+	/**
+	 * Watches the modem status lines (CTS, DSR, DCD, and RI) of a serial port for changes.
+	 * <p>
+	 * A dedicated native thread sleeps in the kernel until one of the selected lines changes state, and records a timestamp on
+	 * the monotonic clock (the same clock used by {@link System#nanoTime()}) as soon as it is woken up, before reading the new
+	 * line states.  The driver's per-line transition counters are consulted as well, so a short pulse that has already ended
+	 * by the time the states are read, such as a PPS pulse on DCD, is still reported as a change.  Events are queued natively
+	 * and retrieved in batches using {@link #readEvents(int)}.
+	 * <p>
+	 * Only one monitor can be active on a port at a time.  The monitor stops when it is closed, when the port is closed, or when
+	 * the device hangs up.  Modem line monitors are currently only supported on Linux, and require a serial driver that supports
+	 * waiting for modem line changes (pseudo-terminals do not).
+	 */
+	static public final class ModemLineMonitor
+	{
+		private final long[] timestamps = new long[256];
+		private final int[] lineStates = new int[256], changedLines = new int[256];
+		private final Object stopLock = new Object();
+		private boolean stopped = false;
+		private long monitorState;
+		
+		/**
+		 * Starts monitoring the specified modem status lines of a serial port.
+		 * 
+		 * @param monitoredPort The open serial port to monitor.
+		 * @param lineMask A bitmask of the lines to monitor, made up of {@link SerialComm#MODEM_LINE_CTS}, {@link SerialComm#MODEM_LINE_DSR},
+		 *                 {@link SerialComm#MODEM_LINE_DCD}, and {@link SerialComm#MODEM_LINE_RI}.
+		 * @throws IOException If the port is closed, its modem lines cannot be read, or it is already being monitored.
+		 */
+		public ModemLineMonitor(SerialComm monitoredPort, int lineMask) throws IOException
+		{
+			if ((monitorState = monitoredPort.createModemLineMonitor(lineMask)) == 0)
+				throw new IOException("Unable to monitor the modem lines of " + monitoredPort.getSystemPortName() + ".");
+		}
+		
+		/**
+		 * Waits for modem line changes and returns every change that has been recorded since the previous call.
+		 * 
+		 * @param timeout The maximum number of milliseconds to wait, or 0 to wait indefinitely.
+		 * @return An array of {@link ModemLineEvent} objects in the order they occurred, which is empty if the timeout expired.
+		 * @throws IOException If the monitor has stopped and every recorded change has already been returned.
+		 */
+		public final synchronized ModemLineEvent[] readEvents(int timeout) throws IOException
+		{
+			int numEvents = (monitorState == 0) ? -1 : readModemLineEvents(monitorState, timestamps, lineStates, changedLines, timeout);
+			if (numEvents < 0)
+				throw new IOException("The modem line monitor has stopped, or this port appears to have been shutdown or disconnected.");
+			
+			ModemLineEvent[] events = new ModemLineEvent[numEvents];
+			for (int i = 0; i < numEvents; ++i)
+				events[i] = new ModemLineEvent(timestamps[i], lineStates[i], changedLines[i]);
+			return events;
+		}
+		
+		/**
+		 * Returns the number of changes that were discarded because they were not read quickly enough.
+		 * 
+		 * @return The number of dropped events.
+		 */
+		public final synchronized long getNumDroppedEvents() { return (monitorState == 0) ? 0 : getNumDroppedModemLineEvents(monitorState); }
+		
+		/**
+		 * Stops monitoring the modem lines and releases the native resources held by this monitor.
+		 * <p>
+		 * A thread blocked in {@link #readEvents(int)} is woken up and receives any remaining events before the monitor is released.
+		 */
+		public final void close()
+		{
+			// Stop the native thread first, so that a blocked reader returns and gives up the lock
+			synchronized (stopLock)
+			{
+				if (!stopped && (monitorState != 0))
+					stopModemLineMonitor(monitorState);
+				stopped = true;
+			}
+			synchronized (this)
+			{
+				if (monitorState != 0)
+					destroyModemLineMonitor(monitorState);
+				monitorState = 0;
+			}
+		}
+		
+		protected final void finalize() throws Throwable
+		{
+			close();
+			super.finalize();
+		}
+	}
+	
+	/**
+	 * Represents a change of the modem status lines recorded by a {@link ModemLineMonitor}.
+	 */
+	static public final class ModemLineEvent
+	{
+		private final long timestamp;
+		private final int lineStates, changedLines;
+		
+		private ModemLineEvent(long eventTime, int eventLineStates, int eventChangedLines)
+		{
+			timestamp = eventTime;
+			lineStates = eventLineStates;
+			changedLines = eventChangedLines;
+		}
+		
+		/**
+		 * Returns the monotonic system time at which the change was reported by the kernel, in nanoseconds.
+		 * 
+		 * @return The timestamp of this change.
+		 */
+		public final long getTimestamp() { return timestamp; }
+		
+		/**
+		 * Returns the states of all modem control lines immediately after this change.
+		 * 
+		 * @return A bitmask of the asserted lines.
+		 */
+		public final int getLineStates() { return lineStates; }
+		
+		/**
+		 * Returns the monitored lines that changed, including lines that toggled and returned to their previous state before
+		 * the change could be read.
+		 * 
+		 * @return A bitmask of the changed lines.
+		 */
+		public final int getChangedLines() { return changedLines; }
+		
+		/**
+		 * Returns whether the specified line was asserted immediately after this change.
+		 * 
+		 * @param line One of the MODEM_LINE constants.
+		 * @return Whether the line was asserted.
+		 */
+		public final boolean isAsserted(int line) { return (lineStates & line) != 0; }
+		
+		/**
+		 * Returns whether the specified line changed.
+		 * 
+		 * @param line One of the MODEM_LINE constants.
+		 * @return Whether the line changed.
+		 */
+		public final boolean hasChanged(int line) { return (changedLines & line) != 0; }
+	}
+	
+	/**
+	 * Decodes a native call trace file created by {@link #dumpNativeTrace(String)}.
+	 * <p>
+	 * The trace can either be printed as a list of calls from all threads in the order they started, with times relative to the
+	 * first recorded call, or summarized as per-function call counts, failures, and durations.
+	 * 
+	 * @param fileName The path of the trace file to decode.
+	 * @param summarize Whether to print a per-function summary instead of every call.
+	 * @param output The stream to print the decoded trace to.
+	 * @throws IOException If the file could not be read or is not a valid trace file.
+	 */
+	static public void printNativeTrace(String fileName, boolean summarize, PrintStream output) throws IOException
+	{
+		// Load the entire trace file and verify its header
+		File traceFile = new File(fileName);
+		byte[] traceData = new byte[(int)traceFile.length()];
+		FileInputStream traceStream = new FileInputStream(traceFile);
+		for (int offset = 0, numRead = 0; (offset < traceData.length) && (numRead >= 0); offset += numRead)
+			numRead = traceStream.read(traceData, offset, traceData.length - offset);
+		traceStream.close();
+		ByteBuffer trace = ByteBuffer.wrap(traceData).order(ByteOrder.LITTLE_ENDIAN);
+		if ((traceData.length < 16) || !new String(traceData, 0, 7, "US-ASCII").equals("SCTRACE") || (trace.getInt(8) != 1) || (trace.getInt(12) < 40))
+			throw new IOException(fileName + " is not a valid native trace file.");
+		
+		// Decode the events recorded by each thread
+		int eventSize = trace.getInt(12), maxEvents = (traceData.length - 16) / eventSize, numEvents = 0;
+		long[] startTimes = new long[maxEvents], arguments = new long[maxEvents], results = new long[maxEvents], durations = new long[maxEvents];
+		int[] threadIds = new int[maxEvents], portSlots = new int[maxEvents], functions = new int[maxEvents], errorCodes = new int[maxEvents];
+		trace.position(16);
+		while (trace.remaining() >= 8)
+		{
+			int threadId = trace.getInt(), numThreadEvents = trace.getInt();
+			for (int i = 0; (i < numThreadEvents) && (trace.remaining() >= eventSize); ++i, ++numEvents)
+			{
+				int eventStart = trace.position();
+				threadIds[numEvents] = threadId;
+				startTimes[numEvents] = trace.getLong();
+				arguments[numEvents] = trace.getLong();
+				results[numEvents] = trace.getLong();
+				durations[numEvents] = trace.getInt() & 0xFFFFFFFFl;
+				portSlots[numEvents] = trace.getInt();
+				functions[numEvents] = trace.getShort() & 0xFFFF;
+				if (functions[numEvents] >= TRACE_FUNCTION_NAMES.length)
+					functions[numEvents] = 0;
+				errorCodes[numEvents] = trace.getShort() & 0xFFFF;
+				trace.position(eventStart + eventSize);
+			}
+		}
+		
+		if (summarize)
+		{
+			// Accumulate per-function statistics, counting negative results and false results of boolean functions as failures
+			int[] numCalls = new int[TRACE_FUNCTION_NAMES.length], numFailures = new int[TRACE_FUNCTION_NAMES.length], numZeroResults = new int[TRACE_FUNCTION_NAMES.length];
+			long[] totalDurations = new long[TRACE_FUNCTION_NAMES.length], maxDurations = new long[TRACE_FUNCTION_NAMES.length];
+			for (int i = 0; i < numEvents; ++i)
+			{
+				int function = functions[i];
+				++numCalls[function];
+				if ((results[i] < 0) || ((function <= TRACE_LAST_BOOLEAN_FUNCTION) && (results[i] == 0)))
+					++numFailures[function];
+				else if (results[i] == 0)
+					++numZeroResults[function];
+				totalDurations[function] += durations[i];
+				maxDurations[function] = Math.max(maxDurations[function], durations[i]);
+			}
+			output.println(String.format("%-22s %10s %10s %10s %14s %14s", "Function", "Calls", "Failed", "Zero", "Mean (ns)", "Max (ns)"));
+			for (int i = 0; i < TRACE_FUNCTION_NAMES.length; ++i)
+				if (numCalls[i] > 0)
+					output.println(String.format("%-22s %10d %10d %10d %14d %14d", TRACE_FUNCTION_NAMES[i], numCalls[i], numFailures[i],
+							numZeroResults[i], totalDurations[i] / numCalls[i], maxDurations[i]));
+		}
+		else
+		{
+			// Print all calls in the order they started
+			final long[] sortTimes = startTimes;
+			Integer[] order = new Integer[numEvents];
+			for (int i = 0; i < numEvents; ++i)
+				order[i] = i;
+			Arrays.sort(order, new java.util.Comparator<Integer>() {
+				public int compare(Integer a, Integer b) { return (sortTimes[a] < sortTimes[b]) ? -1 : (sortTimes[a] > sortTimes[b]) ? 1 : 0; } });
+			for (int j = 0; j < numEvents; ++j)
+			{
+				int i = order[j];
+				output.println(String.format("%14.3f us  thread %-7d %-22s port %-5d arg %-12d result %-12d errno %-4d %10d ns",
+						(startTimes[i] - startTimes[order[0]]) / 1000.0, threadIds[i], TRACE_FUNCTION_NAMES[functions[i]], portSlots[i],
+						arguments[i], results[i], errorCodes[i], durations[i]));
+			}
+		}
+	}
+	
 	static public void main(String[] args)
 	{
 		SerialComm[] ports = SerialComm.getCommPorts();
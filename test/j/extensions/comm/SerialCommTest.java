@@ -0,0 +1,556 @@
+/*
+ * SerialCommTest.java
+ *
+ *       Created on:  Feb 25, 2012
+ *  Last Updated on:  Mar 14, 2013
+ *           Author:  Will Hedgecock
+ *
+ * Copyright (C) 2012-2013 Will Hedgecock
+ *
+ * This file is part of SerialComm.
+ *
+ * SerialComm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SerialComm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SerialComm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+package j.extensions.comm;
+
+import static j.extensions.comm.SerialComm.*;
+
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.lang.reflect.Field;
+import java.util.Arrays;
+
+/**
+ * Self-tests and benchmarks of the native SerialComm features, which are built separately and not shipped in the library jar.
+ * <p>
+ * Run with <i>-selftest</i> to check the natively implemented features, optionally followed by the names of two ports connected
+ * by a null-modem cable (or both ends of a pseudo-terminal) to also check the features that need a port.
+ */
+public class SerialCommTest
+{
+	// Finds a port by its system name or opens the given device path directly (such as a pseudo-terminal), using the default settings
+	static private SerialComm openPortByName(String portName) throws IOException
+	{
+		SerialComm port = null;
+		SerialComm[] ports = getCommPorts();
+		for (int i = 0; i < ports.length; ++i)
+			if (ports[i].getSystemPortName().equals(portName))
+				port = ports[i];
+		if (port == null)
+		{
+			// Ports that are not enumerated can only be reached by setting the device path that getCommPorts() would have filled in
+			port = new SerialComm();
+			try
+			{
+				for (String fieldName : new String[] { "comPort", "portString" })
+				{
+					Field pathField = SerialComm.class.getDeclaredField(fieldName);
+					pathField.setAccessible(true);
+					pathField.set(port, portName);
+				}
+			}
+			catch (Exception e) { throw new IOException("Unable to open " + portName + ": " + e); }
+		}
+		if (!port.openPort())
+			throw new IOException("Unable to open " + portName + ".");
+		return port;
+	}
+	
+	// Measures InputStream throughput for bulk and single-byte reads against unbuffered readBytes(), using two ports connected by a null-modem cable
+	static private void benchmarkInputStream(String receivePortName, String transmitPortName, int numKilobytes) throws IOException
+	{
+		final SerialComm receivePort = openPortByName(receivePortName), transmitPort = openPortByName(transmitPortName);
+		final int numBytes = numKilobytes * 1024;
+		receivePort.setComPortParameters(115200, 8, ONE_STOP_BIT, NO_PARITY);
+		transmitPort.setComPortParameters(115200, 8, ONE_STOP_BIT, NO_PARITY);
+		receivePort.setComPortTimeouts(TIMEOUT_READ_BLOCKING, 0, 0);
+		SerialComm.SerialCommInputStream in = receivePort.getInputStream();
+		byte[] chunk = new byte[numBytes];
+		String[] methodNames = { "InputStream.read(byte[])", "InputStream.read()", "readBytes(byte[], 1)" };
+		
+		for (int method = 0; method < methodNames.length; ++method)
+		{
+			// Transmit from another thread so that the receiver never waits on the sender
+			Thread transmitter = new Thread(new Runnable() { public void run()
+			{
+				byte[] data = new byte[1024];
+				for (int i = 0; i < numBytes; i += data.length)
+					transmitPort.writeBytes(data, data.length);
+			} });
+			long startTime = System.nanoTime();
+			transmitter.start();
+			if (method == 0)
+				in.readFully(chunk, 0, numBytes);
+			else if (method == 1)
+			{
+				for (int i = 0; i < numBytes; ++i)
+					if (in.read() < 0)
+						throw new IOException("Stream ended early.");
+			}
+			else
+			{
+				for (int i = 0; i < numBytes; ++i)
+					if (receivePort.readBytes(chunk, 1) != 1)
+						throw new IOException("Read failed.");
+			}
+			long elapsedTime = System.nanoTime() - startTime;
+			try { transmitter.join(); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+			System.out.println(methodNames[method] + ": " + numKilobytes + " KB in " + (elapsedTime / 1000000.0) + " ms, " +
+					((numBytes * 1000.0) / elapsedTime) + " MB/s");
+		}
+		receivePort.closePort();
+		transmitPort.closePort();
+	}
+	
+	// Measures how long the emulated RS-485 transmitter stays enabled after the last stop bit of each frame, at 115200 baud 8N1
+	static private void benchmarkRs485Turnaround(String portName, int numFrames) throws IOException
+	{
+		SerialComm port = openPortByName(portName);
+		port.setComPortParameters(115200, 8, ONE_STOP_BIT, NO_PARITY);
+		port.setRs485ModeParameters(true, true, 0, 0, true);
+		if (!port.isRs485ModeEnabled() || !port.isRs485ModeEmulated())
+		{
+			System.out.println(port.isRs485ModeEnabled() ? "The driver controls the RS-485 transmitter itself, so its turnaround can only be measured on the bus." :
+				"RS-485 mode could not be enabled on " + portName + ".");
+			port.closePort();
+			return;
+		}
+		
+		// The transmitter is released just before writeBytes() returns, so anything beyond the frame's own transmit time is turnaround
+		byte[] frame = new byte[8];
+		double frameTime = (frame.length * 10 * 1000000000.0) / 115200;
+		long minTurnaround = Long.MAX_VALUE, maxTurnaround = Long.MIN_VALUE, totalTurnaround = 0;
+		for (int i = 0; i < numFrames; ++i)
+		{
+			long startTime = System.nanoTime();
+			if (port.writeBytes(frame, frame.length) != frame.length)
+				throw new IOException("This port appears to have been shutdown or disconnected.");
+			long turnaround = (long)((System.nanoTime() - startTime) - frameTime);
+			minTurnaround = Math.min(minTurnaround, turnaround);
+			maxTurnaround = Math.max(maxTurnaround, turnaround);
+			totalTurnaround += turnaround;
+		}
+		
+		System.out.println("Emulated RS-485 turnaround after the last stop bit of " + numFrames + " frames, including call overhead (us): min " +
+				(minTurnaround / 1000.0) + ", mean " + (totalTurnaround / (numFrames * 1000.0)) + ", max " + (maxTurnaround / 1000.0));
+		port.closePort();
+	}
+	
+	static private void benchmarkGnssParser(String logFileName) throws IOException
+	{
+		// Load the recorded receiver log into memory
+		File logFile = new File(logFileName);
+		byte[] logData = new byte[(int)logFile.length()];
+		FileInputStream logStream = new FileInputStream(logFile);
+		for (int offset = 0, numRead = 0; (offset < logData.length) && (numRead >= 0); offset += numRead)
+			numRead = logStream.read(logData, offset, logData.length - offset);
+		logStream.close();
+		
+		// Parse the entire log repeatedly, visiting every decoded message
+		GnssParser parser = new GnssParser(null);
+		int numPasses = Math.max(1, (64 * 1024 * 1024) / Math.max(logData.length, 1));
+		long startTime = System.nanoTime();
+		for (int i = 0; i < numPasses; ++i)
+			for (int offset = 0; offset < logData.length; )
+			{
+				offset += parser.parse(logData, offset, logData.length - offset);
+				while (parser.nextMessage());
+			}
+		long elapsedTime = System.nanoTime() - startTime;
+		
+		System.out.println("Parsed " + numPasses + " x " + logData.length + " bytes in " + (elapsedTime / 1000000) + " ms: " +
+				(((double)numPasses * logData.length * 1000.0) / elapsedTime) + " MB/s");
+		System.out.println("UBX: " + parser.getNumUbxMessages() + ", NMEA: " + parser.getNumNmeaMessages() + ", checksum errors: " +
+				parser.getNumChecksumErrors() + ", discarded bytes: " + parser.getNumDiscardedBytes());
+		parser.close();
+	}
+	
+	// Measures the delay between toggling RTS and the resulting CTS change being reported, which requires RTS to be looped back to CTS
+	static private void benchmarkModemLineLatency(String portName, int numSamples) throws IOException
+	{
+		SerialComm port = openPortByName(portName);
+		ModemLineMonitor monitor = new ModemLineMonitor(port, MODEM_LINE_CTS);
+		
+		// Toggle RTS and wait for each change to be reported before the next one
+		long minLatency = Long.MAX_VALUE, maxLatency = 0, totalLatency = 0;
+		int numMeasured = 0;
+		for (int i = 0; i < numSamples; ++i)
+		{
+			long toggleTime = System.nanoTime();
+			port.setRTS((i % 2) == 0);
+			ModemLineEvent[] events = monitor.readEvents(1000);
+			if (events.length == 0)
+				continue;
+			long latency = events[0].getTimestamp() - toggleTime;
+			minLatency = Math.min(minLatency, latency);
+			maxLatency = Math.max(maxLatency, latency);
+			totalLatency += latency;
+			++numMeasured;
+		}
+		
+		System.out.println("Measured " + numMeasured + " of " + numSamples + " RTS to CTS transitions, " + monitor.getNumDroppedEvents() + " dropped");
+		if (numMeasured > 0)
+			System.out.println("Latency (us): min " + (minLatency / 1000.0) + ", mean " + (totalLatency / (numMeasured * 1000.0)) + ", max " + (maxLatency / 1000.0));
+		monitor.close();
+		port.closePort();
+	}
+	
+	// Reports the outcome of a single self-test check, returning the number of failures it represents
+	static private int check(String description, boolean passed)
+	{
+		System.out.println((passed ? "ok      " : "FAILED  ") + description);
+		return passed ? 0 : 1;
+	}
+	
+	// Returns the bytes of a string, treating each character as a single byte
+	static private byte[] asciiBytes(String text)
+	{
+		byte[] bytes = new byte[text.length()];
+		for (int i = 0; i < bytes.length; ++i)
+			bytes[i] = (byte)text.charAt(i);
+		return bytes;
+	}
+	
+	// Builds a UBX frame, corrupting its checksum if requested
+	static private byte[] buildUbxFrame(int messageClass, int messageId, byte[] payload, boolean corrupt)
+	{
+		byte[] frame = new byte[payload.length + 8];
+		frame[0] = (byte)0xB5;
+		frame[1] = (byte)0x62;
+		frame[2] = (byte)messageClass;
+		frame[3] = (byte)messageId;
+		frame[4] = (byte)payload.length;
+		frame[5] = (byte)(payload.length >> 8);
+		System.arraycopy(payload, 0, frame, 6, payload.length);
+		int checksumA = 0, checksumB = 0;
+		for (int i = 2; i < (frame.length - 2); ++i)
+		{
+			checksumA = (checksumA + (frame[i] & 0xFF)) & 0xFF;
+			checksumB = (checksumB + checksumA) & 0xFF;
+		}
+		frame[frame.length - 2] = (byte)checksumA;
+		frame[frame.length - 1] = (byte)(corrupt ? (checksumB ^ 0xFF) : checksumB);
+		return frame;
+	}
+	
+	// Builds an NMEA sentence with its checksum and line ending
+	static private String buildNmeaSentence(String body)
+	{
+		int checksum = 0;
+		for (int i = 0; i < body.length(); ++i)
+			checksum ^= body.charAt(i);
+		return "$" + body + "*" + String.format("%02X", checksum) + "\r\n";
+	}
+	
+	// Describes every message decoded by the most recent parse, appending to the given description
+	static private void describeGnssMessages(GnssParser parser, StringBuilder description)
+	{
+		while (parser.nextMessage())
+		{
+			description.append(parser.getMessageType()).append(':').append(parser.getUbxClass()).append(':').append(parser.getUbxId()).append(':');
+			for (int i = 0; i < parser.getPayloadLength(); ++i)
+				description.append((char)(parser.getMessageBuffer().get(parser.getPayloadOffset() + i) & 0xFF));
+			description.append(';');
+		}
+	}
+	
+	// Checks the GNSS parser against a stream of valid, corrupt, and unrelated data, delivered all at once and one byte at a time
+	static private int selfTestGnssParser()
+	{
+		ByteArrayOutputStream stream = new ByteArrayOutputStream();
+		byte[] navPvt = buildUbxFrame(0x01, 0x07, asciiBytes("PVT!"), false), corrupt = buildUbxFrame(0x01, 0x07, asciiBytes("PVT?"), true);
+		byte[] nmea = asciiBytes(buildNmeaSentence("GPGGA,123519,4807.038,N"));
+		stream.write(navPvt, 0, navPvt.length);
+		stream.write(nmea, 0, nmea.length);
+		stream.write(corrupt, 0, corrupt.length);
+		stream.write('x');
+		stream.write('y');
+		stream.write('z');
+		stream.write(navPvt, 0, navPvt.length);
+		byte[] data = stream.toByteArray();
+		String expected = GNSS_MESSAGE_UBX + ":1:7:PVT!;" + GNSS_MESSAGE_NMEA + ":0:0:GPGGA,123519,4807.038,N;" + GNSS_MESSAGE_UBX + ":1:7:PVT!;";
+		int numFailures = 0;
+		
+		GnssParser parser = new GnssParser(null);
+		StringBuilder decoded = new StringBuilder();
+		numFailures += check("GNSS parser consumes a whole block", parser.parse(data, 0, data.length) == data.length);
+		describeGnssMessages(parser, decoded);
+		numFailures += check("GNSS parser decodes UBX and NMEA messages", decoded.toString().equals(expected));
+		numFailures += check("GNSS parser counts messages by type", (parser.getNumUbxMessages() == 2) && (parser.getNumNmeaMessages() == 1));
+		numFailures += check("GNSS parser drops a message with a bad checksum", parser.getNumChecksumErrors() == 1);
+		numFailures += check("GNSS parser discards the corrupt frame and stray bytes", parser.getNumDiscardedBytes() == (corrupt.length + 3));
+		parser.close();
+		
+		parser = new GnssParser(null);
+		decoded.setLength(0);
+		for (int i = 0; i < data.length; ++i)
+		{
+			parser.parse(data, i, 1);
+			describeGnssMessages(parser, decoded);
+		}
+		numFailures += check("GNSS parser decodes the same messages one byte at a time", decoded.toString().equals(expected));
+		parser.close();
+		return numFailures;
+	}
+	
+	// Calculates the CRC-16/XMODEM checksum of part of a block
+	static private int calculateCrc16(byte[] data, int offset, int length)
+	{
+		int crc = 0;
+		for (int i = offset; i < (offset + length); ++i)
+		{
+			crc ^= (data[i] & 0xFF) << 8;
+			for (int bit = 0; bit < 8; ++bit)
+				crc = ((crc & 0x8000) != 0) ? (((crc << 1) ^ 0x1021) & 0xFFFF) : ((crc << 1) & 0xFFFF);
+		}
+		return crc;
+	}
+	
+	// Checks that a zero-length read returns immediately and leaves the port open
+	static private int selfTestZeroLengthRead(SerialComm port)
+	{
+		byte[] buffer = new byte[16];
+		int numFailures = check("zero-length read returns 0", port.readBytes(buffer, 0) == 0);
+		numFailures += check("zero-length read leaves the port open", port.bytesAvailable() >= 0);
+		return numFailures;
+	}
+	
+	// Checks the expect automaton: longest match at the same byte, nothing consumed past a match, and timeouts
+	static private int selfTestExpect(SerialComm port, SerialComm device) throws IOException
+	{
+		ExpectPatterns patterns = new ExpectPatterns(new String[] { "OK", "ERROR", "CME ERROR" });
+		byte[] response = asciiBytes("AT+CPIN?\r\r\n+CME ERROR: 10\r\nOK\r\n"), rest = new byte[16];
+		device.writeBytes(response, response.length);
+		ExpectResult first = port.expect(patterns, 2000), second = port.expect(patterns, 2000);
+		int numFailures = check("expect reports the longest pattern ending at the same byte", (first.getPatternIndex() == 2) &&
+				first.getResponse().equals("AT+CPIN?\r\r\n+CME ERROR"));
+		numFailures += check("expect resumes right after the previous match", (second.getPatternIndex() == 0) && second.getResponse().equals(": 10\r\nOK"));
+		port.setComPortTimeouts(TIMEOUT_READ_SEMI_BLOCKING, 1000, 0);
+		numFailures += check("expect leaves the data after a match unread", (port.readBytes(rest, rest.length) == 2) && (rest[0] == '\r') && (rest[1] == '\n'));
+		ExpectResult timedOut = port.expect(patterns, 200);
+		numFailures += check("expect times out without data", timedOut.isTimedOut() && (timedOut.getData().length == 0));
+		patterns.close();
+		return numFailures;
+	}
+	
+	// Checks XMODEM framing by receiving a file on the other end of the link, rejecting the first block once
+	static private int selfTestXmodem(final SerialComm port, SerialComm device) throws IOException
+	{
+		// Create a file that needs two full blocks and one padded block
+		final File file = File.createTempFile("serialcomm-selftest", ".bin");
+		final byte[] contents = new byte[300];
+		for (int i = 0; i < contents.length; ++i)
+			contents[i] = (byte)(i * 7);
+		FileOutputStream fileStream = new FileOutputStream(file);
+		fileStream.write(contents);
+		fileStream.close();
+		
+		// Send the file from another thread, while this thread plays the receiver
+		final long[] bytesSent = { -1 };
+		Thread sender = new Thread(new Runnable() { public void run()
+		{
+			try { bytesSent[0] = port.sendFile(file.getPath(), 0, -1, FILE_TRANSFER_XMODEM); } catch (IOException e) { bytesSent[0] = -2; }
+		} });
+		sender.start();
+		device.setComPortTimeouts(TIMEOUT_READ_BLOCKING, 5000, 0);
+		device.writeBytes(new byte[] { 'C' }, 1);
+		byte[] block = new byte[133], previousBlock = null, reply = new byte[1];
+		boolean framingValid = true, retransmitted = false;
+		ByteArrayOutputStream received = new ByteArrayOutputStream();
+		for (int blockNumber = 1; blockNumber <= 3; ++blockNumber)
+		{
+			if (device.readBytes(block, block.length) != block.length)
+			{
+				framingValid = false;
+				break;
+			}
+			int crc = calculateCrc16(block, 3, 128);
+			framingValid = framingValid && (block[0] == 0x01) && ((block[1] & 0xFF) == blockNumber) && ((block[2] & 0xFF) == (255 - blockNumber)) &&
+					((block[131] & 0xFF) == (crc >> 8)) && ((block[132] & 0xFF) == (crc & 0xFF));
+			
+			// Reject the first copy of the first block, which must then be sent again unchanged
+			if ((blockNumber == 1) && (previousBlock == null))
+			{
+				previousBlock = block.clone();
+				--blockNumber;
+				device.writeBytes(new byte[] { 0x15 }, 1);
+				continue;
+			}
+			else if (blockNumber == 1)
+				retransmitted = Arrays.equals(block, previousBlock);
+			received.write(block, 3, 128);
+			device.writeBytes(new byte[] { 0x06 }, 1);
+		}
+		boolean endOfTransmission = (device.readBytes(reply, 1) == 1) && (reply[0] == 0x04);
+		device.writeBytes(new byte[] { 0x06 }, 1);
+		try { sender.join(10000); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+		file.delete();
+		
+		// The final block is padded with CP/M end-of-file characters
+		byte[] expected = new byte[384];
+		Arrays.fill(expected, (byte)0x1A);
+		System.arraycopy(contents, 0, expected, 0, contents.length);
+		int numFailures = check("XMODEM blocks have valid headers and CRCs", framingValid);
+		numFailures += check("XMODEM resends a rejected block unchanged", retransmitted);
+		numFailures += check("XMODEM sends the file padded to whole blocks", Arrays.equals(received.toByteArray(), expected));
+		numFailures += check("XMODEM ends the transfer with EOT", endOfTransmission);
+		numFailures += check("XMODEM reports the file length as sent", bytesSent[0] == contents.length);
+		return numFailures;
+	}
+	
+	// Reads exactly the requested number of bytes from a broker client, returning false if they did not all arrive in time
+	static private boolean readFromBrokerFully(PortBrokerClient client, byte[] buffer, int length) throws IOException
+	{
+		int numBytesRead, offset = 0;
+		while ((offset < length) && ((numBytesRead = client.readBytes(buffer, offset, length - offset, 2000)) > 0))
+			offset += numBytesRead;
+		return offset == length;
+	}
+	
+	// Checks that a port broker client loses exactly the overwritten data when it falls behind, and reads correctly across the ring boundary
+	static private int selfTestPortBroker(SerialComm port, SerialComm device) throws IOException
+	{
+		final int ringSize = 4096;
+		PortBroker broker = new PortBroker(port, "selftest", ringSize, ringSize);
+		PortBrokerClient client = new PortBrokerClient("selftest");
+		broker.start();
+		
+		// Publish three rings' worth of numbered bytes without reading any of them
+		byte[] stream = new byte[(3 * ringSize) + (10 * 1000)], buffer = new byte[ringSize];
+		for (int i = 0; i < stream.length; ++i)
+			stream[i] = (byte)(i % 251);
+		device.writeBytes(stream, 3 * ringSize);
+		try { Thread.sleep(500); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+		boolean caughtUp = readFromBrokerFully(client, buffer, ringSize);
+		boolean newestKept = true;
+		for (int i = 0; i < ringSize; ++i)
+			newestKept = newestKept && (buffer[i] == stream[(2 * ringSize) + i]);
+		int numFailures = check("broker client reports the overwritten bytes as lost", caughtUp && (client.getNumBytesLost() == (2 * ringSize)));
+		numFailures += check("broker client resumes at the oldest data still in the ring", newestKept);
+		
+		// Keep up with the publisher for a while, so that reads start and end at every offset around the end of the ring
+		boolean wrappedInOrder = true;
+		byte[] chunk = new byte[1000];
+		for (int offset = 3 * ringSize; offset < stream.length; offset += chunk.length)
+		{
+			System.arraycopy(stream, offset, buffer, 0, chunk.length);
+			device.writeBytes(buffer, chunk.length);
+			wrappedInOrder = wrappedInOrder && readFromBrokerFully(client, chunk, chunk.length);
+			for (int i = 0; i < chunk.length; ++i)
+				wrappedInOrder = wrappedInOrder && (chunk[i] == stream[offset + i]);
+		}
+		numFailures += check("broker client reads in order across the ring boundary", wrappedInOrder);
+		numFailures += check("broker client loses nothing while keeping up", client.getNumBytesLost() == (2 * ringSize));
+		
+		// Data written by a client is transmitted by the broker
+		byte[] request = asciiBytes("broker write"), transmitted = new byte[request.length];
+		client.writeBytes(request, 0, request.length);
+		device.setComPortTimeouts(TIMEOUT_READ_BLOCKING, 2000, 0);
+		numFailures += check("broker transmits data written by a client", (device.readBytes(transmitted, transmitted.length) == transmitted.length) &&
+				Arrays.equals(transmitted, request));
+		client.close();
+		broker.close();
+		return numFailures;
+	}
+	
+	// Checks that closing a port wakes up a thread blocked reading from it
+	static private int selfTestCloseWakesReader(final SerialComm port)
+	{
+		final int[] result = { 0 };
+		final long[] returnTime = { 0 };
+		port.setComPortTimeouts(TIMEOUT_READ_BLOCKING, 0, 0);
+		Thread reader = new Thread(new Runnable() { public void run()
+		{
+			result[0] = port.readBytes(new byte[16], 16);
+			returnTime[0] = System.nanoTime();
+		} });
+		reader.start();
+		try { Thread.sleep(100); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+		long closeTime = System.nanoTime();
+		port.closePort();
+		try { reader.join(5000); } catch (InterruptedException e) { Thread.currentThread().interrupt(); }
+		int numFailures = check("close wakes a blocked reader with an error", !reader.isAlive() && (result[0] == -1));
+		numFailures += check("blocked reader wakes within 100 ms of close", !reader.isAlive() && ((returnTime[0] - closeTime) < 100000000l));
+		return numFailures;
+	}
+	
+	// Runs behavior checks of the native features, using two ports connected by a null-modem cable if they were specified, and returns the number of failures
+	static private int selfTest(String portName, String devicePortName) throws IOException
+	{
+		int numFailures = selfTestGnssParser();
+		if (portName != null)
+		{
+			SerialComm port = openPortByName(portName), device = openPortByName(devicePortName);
+			port.setComPortParameters(115200, 8, ONE_STOP_BIT, NO_PARITY);
+			device.setComPortParameters(115200, 8, ONE_STOP_BIT, NO_PARITY);
+			numFailures += selfTestZeroLengthRead(port);
+			numFailures += selfTestExpect(port, device);
+			numFailures += selfTestXmodem(port, device);
+			numFailures += selfTestPortBroker(port, device);
+			numFailures += selfTestCloseWakesReader(port);
+			device.closePort();
+		}
+		System.out.println(numFailures + ((numFailures == 1) ? " check failed" : " checks failed"));
+		return numFailures;
+	}
+	
+	static public void main(String[] args)
+	{
+		try
+		{
+			// Check the behavior of the native features, over a null-modem connected pair of ports if they were specified
+			if (((args.length == 1) || (args.length == 3)) && args[0].equals("-selftest"))
+				System.exit((selfTest((args.length == 3) ? args[1] : null, (args.length == 3) ? args[2] : null) == 0) ? 0 : 1);
+			
+			// Measure the emulated RS-485 transmitter turnaround on a real port
+			else if ((args.length == 3) && args[0].equals("-rs485turnaround"))
+				benchmarkRs485Turnaround(args[1], Integer.parseInt(args[2]));
+			
+			// Benchmark the input stream over a null-modem connected pair of ports
+			else if ((args.length == 4) && args[0].equals("-streambench"))
+				benchmarkInputStream(args[1], args[2], Integer.parseInt(args[3]));
+			
+			// Measure modem line event latency on a port with RTS looped back to CTS
+			else if ((args.length == 3) && args[0].equals("-modemlatency"))
+				benchmarkModemLineLatency(args[1], Integer.parseInt(args[2]));
+			
+			// Benchmark the GNSS parser against a recorded receiver log
+			else if ((args.length == 2) && args[0].equals("-gnssbench"))
+				benchmarkGnssParser(args[1]);
+			
+			// Decode a native call trace file
+			else if ((args.length == 2) && (args[0].equals("-tracedump") || args[0].equals("-tracesummary")))
+				printNativeTrace(args[1], args[0].equals("-tracesummary"), System.out);
+			
+			else
+			{
+				System.out.println("Usage: SerialCommTest -selftest [<port> <device port>]");
+				System.out.println("       SerialCommTest -streambench <receive port> <transmit port> <kilobytes>");
+				System.out.println("       SerialCommTest -rs485turnaround <port> <frames>");
+				System.out.println("       SerialCommTest -modemlatency <port> <samples>");
+				System.out.println("       SerialCommTest -gnssbench <log file>");
+				System.out.println("       SerialCommTest -tracedump|-tracesummary <trace file>");
+			}
+		}
+		catch (Exception e)
+		{
+			e.printStackTrace();
+			System.exit(1);
+		}
+	}
+}